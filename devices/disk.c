@@ -86,6 +86,7 @@ static void identify_ata_device (struct disk *);
 
 static void select_sector (struct disk *, disk_sector_t);
 static void issue_pio_command (struct channel *, uint8_t command);
+static bool wait_for_completion (struct disk *);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
@@ -218,8 +219,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
+	if (!wait_for_completion (d) || !wait_while_busy (d))
 		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
 	input_sector (c, buffer);
 	d->read_cnt++;
@@ -245,7 +245,8 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
 	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
+	if (!wait_for_completion (d))
+		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
 	d->write_cnt++;
 	lock_release (&c->lock);
 }
@@ -354,8 +355,7 @@ identify_ata_device (struct disk *d) {
 	   into our buffer. */
 	select_device_wait (d);
 	issue_pio_command (c, CMD_IDENTIFY_DEVICE);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d)) {
+	if (!wait_for_completion (d) || !wait_while_busy (d)) {
 		d->is_ata = false;
 		return;
 	}
@@ -432,6 +432,28 @@ issue_pio_command (struct channel *c, uint8_t command) {
 	outb (reg_command (c), command);
 }
 
+/* Waits up to 30 seconds for the completion interrupt of the
+   command last issued to disk D.  Returns true if it arrived,
+   false if the disk never raised it. */
+static bool
+wait_for_completion (struct disk *d) {
+	struct channel *c = d->channel;
+	enum intr_level old_level;
+
+	if (sema_down_timeout (&c->completion_wait, 30 * TIMER_FREQ))
+		return true;
+
+	/* Any interrupt from now on is spurious.  One that came in
+	   since the timeout must not complete the next command. */
+	old_level = intr_disable ();
+	c->expecting_interrupt = false;
+	sema_try_down (&c->completion_wait);
+	intr_set_level (old_level);
+
+	printf ("%s: completion timeout\n", d->name);
+	return false;
+}
+
 /* Reads a sector from channel C's data register in PIO mode into
    SECTOR, which must have room for DISK_SECTOR_SIZE bytes. */
 static void
@@ -1,5 +1,6 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
@@ -7,6 +8,8 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -17,66 +20,155 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Only the timer
+   interrupt and the idle path write it, under ticks_seq, so that
+   timer_ticks() can read it without disabling interrupts. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* 8254 input frequency, and the counter value that makes it
+   interrupt TIMER_FREQ times per second. */
+#define PIT_HZ 1193180
+#define PIT_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot period, in ticks, that fits in the 8254's
+   16-bit counter.  At TIMER_FREQ == 100 that is only 5 ticks, so
+   however long the CPU idles, it still takes an interrupt at
+   least every 5 ticks. */
+#define TICKLESS_MAX (0xffff / PIT_COUNT)
+
+/* If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Length, in ticks, of the stretched period the 8254 is counting
+   down while idle, or 0 if it is running at TIMER_FREQ.  The
+   stretched period began idle_elapsed input clocks into a tick,
+   and idle_count is the one-shot count that ends it on a tick
+   boundary. */
+static int64_t idle_period;
+static unsigned idle_elapsed;
+static unsigned idle_count;
+
+#define NS_PER_SEC 1000000000
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* Number of ticks timer_calibrate() times the TSC over. */
+#define TSC_CALIBRATE_TICKS 4
+
+/* Sleeps shorter than this many nanoseconds spin on the TSC,
+   because blocking and waking up again would take longer. */
+#define SPIN_NS 20000
+
+/* Shortest one-shot count given to the 8254, so that an
+   interrupt is never requested for a moment already past. */
+#define PIT_MIN_COUNT 2
+
+/* TSC frequency in Hz, or 0 until timer_calibrate() measures it,
+   and the TSC value at timer_init(), from which timer_ns()
+   counts. */
+static uint64_t tsc_hz;
+static uint64_t tsc_boot;
+
+/* A thread blocked in hr_sleep().  Lives on its stack. */
+struct hr_sleeper {
+	uint64_t deadline;          /* TSC value to wake up at. */
+	struct thread *thread;      /* The sleeping thread. */
+	struct heap_elem elem;      /* Element in hr_sleepers. */
+};
+
+/* Threads sleeping until a TSC deadline, earliest first. */
+static struct heap hr_sleepers;
+
+/* What counter 0 of the 8254 is counting down to.  To wake a
+   thread in the middle of a tick, the tick is split in two
+   one-shot periods: the first ends at the thread's deadline, and
+   the second, pit_rest counts long, ends where the tick would
+   have.  Only the end of the second counts as a tick. */
+enum pit_state {
+	PIT_PERIODIC,               /* The next tick, periodically. */
+	PIT_EARLY,                  /* A deadline, ahead of the tick. */
+	PIT_TAIL                    /* The rest of a split tick. */
+};
+static enum pit_state pit_state;
+static unsigned pit_rest;
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void hr_sleep (uint64_t deadline);
+static bool hr_sleeper_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static void hr_wake (void);
+static void hr_arm (void);
+static uint64_t ns_to_tsc (uint64_t ns);
+static void pit_program (int64_t period);
+static void pit_oneshot (unsigned count);
+static unsigned pit_count (void);
+static bool pit_irq_pending (void);
+static void timer_credit_idle (int64_t skipped);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
-
+	tsc_boot = rdtsc ();
+	seqlock_init (&ticks_seq);
+	heap_init (&hr_sleepers, hr_sleeper_less, NULL);
+	pit_program (1);
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Measures the frequency of the time-stamp counter against the
+   8254, for timer_ns() and for sleeps shorter than a tick.
+
+   The TSC is only a clock if it is invariant, that is, if it
+   ticks at a constant rate whatever the CPU's power state, which
+   CPUID reports.  Virtual machines, where this kernel usually
+   runs, often do not report it even though their TSC is
+   constant, so a TSC without the flag is used anyway, with a
+   warning. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	uint32_t a, b, c, d;
+	bool invariant = false;
+	uint64_t start_tsc;
+	int64_t start;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
+	cpuid (0x80000000, &a, &b, &c, &d);
+	if (a >= 0x80000007) {
+		cpuid (0x80000007, &a, &b, &c, &d);
+		invariant = (d & (1 << 8)) != 0;
 	}
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	/* Time TSC_CALIBRATE_TICKS whole ticks, from the start of
+	   one to the start of another. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
+	start_tsc = rdtsc ();
+	start = ticks;
+	while (ticks - start < TSC_CALIBRATE_TICKS)
+		barrier ();
+	tsc_hz = (rdtsc () - start_tsc) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	printf ("%'"PRIu64" kHz TSC%s.\n", tsc_hz / 1000,
+			invariant ? "" : " (not invariant)");
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) {
-	enum intr_level old_level = intr_disable ();
-	int64_t t = ticks;
-	intr_set_level (old_level);
-	barrier ();
+	unsigned start;
+	int64_t t;
+
+	do {
+		start = seqlock_read_begin (&ticks_seq);
+		t = ticks;
+	} while (seqlock_read_retry (&ticks_seq, start));
 	return t;
 }
 
@@ -87,6 +179,25 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since timer_init().  Before
+   timer_calibrate(), has only the resolution of a timer tick. */
+uint64_t
+timer_ns (void) {
+	if (tsc_hz == 0)
+		return timer_ticks () * NS_PER_TICK;
+	return timer_tsc_to_ns (rdtsc () - tsc_boot);
+}
+
+/* Converts CYCLES, a difference between two rdtsc() readings,
+   into nanoseconds.  Returns 0 before timer_calibrate(). */
+uint64_t
+timer_tsc_to_ns (uint64_t cycles) {
+	if (tsc_hz == 0)
+		return 0;
+	return cycles / tsc_hz * NS_PER_SEC
+		+ cycles % tsc_hz * NS_PER_SEC / tsc_hz;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
@@ -112,6 +223,96 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, right before
+   it halts.  In tickless mode, stretches the timer period so that
+   the next interrupt arrives at the earliest sleeper's deadline
+   (or as close as the 8254 can reach) instead of every tick.
+   The skipped ticks are credited when the CPU wakes up, either by
+   that interrupt or by timer_idle_exit().
+
+   Reprogramming the 8254 restarts its count, so the stretched
+   period is a one-shot shortened by the part of the current tick
+   that has already elapsed.  It thus ends on a tick boundary,
+   and idling does not make `ticks' fall behind real time. */
+void
+timer_idle_enter (void) {
+	int64_t period;
+	unsigned elapsed;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || idle_period != 0)
+		return;
+
+	/* Threads sleeping on the TSC need the 8254 as it is. */
+	if (pit_state != PIT_PERIODIC || !heap_empty (&hr_sleepers))
+		return;
+
+	period = thread_next_wakeup ();
+	if (workqueue_next_due () < period)
+		period = workqueue_next_due ();
+	period -= ticks;
+	if (period > TICKLESS_MAX)
+		period = TICKLESS_MAX;
+
+	/* The MLFQS decays recent_cpu and updates load_avg once per
+	   second, so never sleep past a second boundary. */
+	if (thread_mlfqs && period > TIMER_FREQ - ticks % TIMER_FREQ)
+		period = TIMER_FREQ - ticks % TIMER_FREQ;
+
+	if (period <= 1)
+		return;
+
+	/* A tick that has just ended is counted by its interrupt
+	   first. */
+	if (pit_irq_pending ())
+		return;
+	elapsed = PIT_COUNT - pit_count ();
+	if (elapsed >= PIT_COUNT)
+		return;
+
+	idle_period = period;
+	idle_elapsed = elapsed;
+	idle_count = PIT_COUNT * period - elapsed;
+	pit_oneshot (idle_count);
+}
+
+/* Called by the scheduler, with interrupts off, when the idle
+   thread is switched out.  If the CPU was woken early by some
+   other interrupt, credits the whole ticks that elapsed and has
+   the 8254 count down the rest of the tick in progress as the
+   tail of a split tick, after which it interrupts every tick
+   again, in the same phase as before. */
+void
+timer_idle_exit (void) {
+	int64_t skipped;
+	unsigned total, rest;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (idle_period == 0)
+		return;
+
+	if (pit_irq_pending ()) {
+		/* The long period already expired.  Its interrupt is
+		   still due; as the end of a split tick, it counts the
+		   final tick and restarts the periodic tick itself. */
+		skipped = idle_period - 1;
+		pit_state = PIT_TAIL;
+	} else {
+		/* Input clocks since the start of the tick that was in
+		   progress when the CPU went idle. */
+		total = idle_elapsed + (idle_count - pit_count ());
+		skipped = total / PIT_COUNT;
+		rest = PIT_COUNT - total % PIT_COUNT;
+		pit_state = PIT_TAIL;
+		pit_oneshot (rest < PIT_MIN_COUNT ? PIT_MIN_COUNT : rest);
+	}
+
+	idle_period = 0;
+	timer_credit_idle (skipped);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
@@ -122,76 +323,226 @@ timer_print_stats (void) {
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  if (pit_state == PIT_EARLY) {
+    /* A sleeper's deadline, in the middle of a tick.  Count down
+       the rest of the tick, and do none of the per-tick work. */
+    pit_state = PIT_TAIL;
+    pit_oneshot (pit_rest);
+    hr_wake ();
+    hr_arm ();
+    return;
+  }
+  if (pit_state == PIT_TAIL) {
+    pit_state = PIT_PERIODIC;
+    pit_program (1);
+  }
+
+  if (idle_period != 0) {
+    /* A stretched idle period ended, on a tick boundary.  This
+       interrupt stands for its last tick; the ones before it were
+       skipped. */
+    int64_t skipped = idle_period - 1;
+
+    idle_period = 0;
+    pit_program (1);
+    timer_credit_idle (skipped);
+  }
+
+  seqlock_write_begin (&ticks_seq);
   ticks++;
+  seqlock_write_end (&ticks_seq);
   thread_tick ();
 
   if (thread_mlfqs) {
     mlfqs_increment_recent_cpu ();
-    if (ticks % 4 == 0) {
+    if (ticks % TIMER_FREQ == 0) {
+      /* Also recomputes the priorities of all runnable threads. */
+      mlfqs_recalculate_recent_cpu ();
+      mlfqs_calculate_load_avg ();
+    } else if (ticks % 4 == 0)
       mlfqs_recalculate_priority ();
-      if (ticks % TIMER_FREQ == 0) {
-        mlfqs_recalculate_recent_cpu ();
-        mlfqs_calculate_load_avg ();
-      }
-    }
   }
 
   thread_awake (ticks);
+  workqueue_timer (ticks);
+  hr_wake ();
+  hr_arm ();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+/* Programs counter 0 of the 8254 to interrupt every PERIOD
+   ticks, which must not exceed TICKLESS_MAX, starting from now. */
+static void
+pit_program (int64_t period) {
+	/* 8254 input frequency divided by TIMER_FREQ, rounded to
+	   nearest, times PERIOD. */
+	uint16_t count = PIT_COUNT * period;
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+	ASSERT (period >= 1 && period <= TICKLESS_MAX);
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Programs counter 0 of the 8254 to interrupt once, COUNT input
+   clocks from now. */
+static void
+pit_oneshot (unsigned count) {
+	ASSERT (count >= 1 && count <= 0xffff);
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
 }
 
-/* Sleep for approximately NUM/DENOM seconds. */
+/* Returns the number of input clocks left before counter 0 of
+   the 8254 interrupts. */
+static unsigned
+pit_count (void) {
+	unsigned count;
+
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	count = inb (0x40);
+	count |= inb (0x40) << 8;
+	return count;
+}
+
+/* Returns true if the master PIC has a timer interrupt (IRQ 0)
+   raised but not yet delivered. */
+static bool
+pit_irq_pending (void) {
+	outb (0x20, 0x0a);    /* OCW3: next read returns the IRR. */
+	return (inb (0x20) & 0x01) != 0;
+}
+
+/* Accounts for SKIPPED ticks that passed while the CPU was idle
+   with the periodic tick stopped.  Only the idle thread ran and
+   no sleeper was due during them, so advancing the clock and the
+   idle statistics is all the per-tick work they would have done. */
 static void
-real_time_sleep (int64_t num, int32_t denom) {
-	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
+timer_credit_idle (int64_t skipped) {
+	seqlock_write_begin (&ticks_seq);
+	ticks += skipped;
+	seqlock_write_end (&ticks_seq);
+	thread_credit_idle_ticks (skipped);
+}
+
+/* Sleep for approximately NUM/DENOM seconds.  DENOM must
+   divide 1,000,000,000.
 
-	   (NUM / DENOM) s
-	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-	   1 s / TIMER_FREQ ticks
-	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
+   Whole ticks are slept with timer_sleep(), like any other sleep.
+   What is left, less than a tick, is slept with hr_sleep(), which
+   has the 8254 interrupt at the deadline, or spun away on the TSC
+   if it is too short to be worth blocking for. */
+static void
+real_time_sleep (int64_t num, int32_t denom) {
+	int64_t ns = num * (NS_PER_SEC / denom);
+	uint64_t deadline, now;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
-		/* We're waiting for at least one full timer tick.  Use
-		   timer_sleep() because it will yield the CPU to other
-		   processes. */
-		timer_sleep (ticks);
-	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+	ASSERT (NS_PER_SEC % denom == 0);
+	if (ns <= 0)
+		return;
+	if (tsc_hz == 0) {
+		timer_sleep (DIV_ROUND_UP (ns, NS_PER_TICK));
+		return;
+	}
+
+	deadline = rdtsc () + ns_to_tsc (ns);
+	if (ns >= NS_PER_TICK)
+		timer_sleep (ns / NS_PER_TICK);
+	while ((now = rdtsc ()) < deadline) {
+		if (deadline - now > ns_to_tsc (SPIN_NS))
+			hr_sleep (deadline);
+		else
+			barrier ();
 	}
-}
\ No newline at end of file
+}
+
+/* Blocks the running thread until the TSC reaches DEADLINE,
+   which should be less than a tick away. */
+static void
+hr_sleep (uint64_t deadline) {
+	struct hr_sleeper s;
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	s.deadline = deadline;
+	s.thread = thread_current ();
+
+	old_level = intr_disable ();
+	heap_push (&hr_sleepers, &s.elem);
+	hr_arm ();
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Orders hr_sleepers by deadline. */
+static bool
+hr_sleeper_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct hr_sleeper, elem)->deadline
+		< heap_entry (b, struct hr_sleeper, elem)->deadline;
+}
+
+/* Wakes every thread in hr_sleepers whose deadline has passed. */
+static void
+hr_wake (void) {
+	uint64_t now = rdtsc ();
+	bool woken = false;
+
+	while (!heap_empty (&hr_sleepers)) {
+		struct hr_sleeper *s = heap_entry (heap_top (&hr_sleepers),
+				struct hr_sleeper, elem);
+
+		if (s->deadline > now)
+			break;
+		heap_pop (&hr_sleepers);
+		thread_unblock (s->thread);
+		woken = true;
+	}
+	if (woken)
+		thread_test_preemption ();
+}
+
+/* If the earliest deadline in hr_sleepers comes before the next
+   tick, splits the tick so that the 8254 interrupts at it.  Must
+   be called with interrupts off. */
+static void
+hr_arm (void) {
+	struct hr_sleeper *s;
+	unsigned left, to_tick;
+	uint64_t now;
+	uint64_t count;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (heap_empty (&hr_sleepers) || idle_period != 0 || pit_irq_pending ())
+		return;
+
+	/* LEFT is what remains of the period being counted down. */
+	left = pit_count ();
+	to_tick = left + (pit_state == PIT_EARLY ? pit_rest : 0);
+
+	s = heap_entry (heap_top (&hr_sleepers), struct hr_sleeper, elem);
+	now = rdtsc ();
+	if (s->deadline >= now + tsc_hz / TIMER_FREQ)
+		return;
+	count = s->deadline > now
+		? DIV_ROUND_UP ((s->deadline - now) * PIT_HZ, tsc_hz) : 0;
+	if (count < PIT_MIN_COUNT)
+		count = PIT_MIN_COUNT;
+	if (count + PIT_MIN_COUNT >= (pit_state == PIT_EARLY ? left : to_tick))
+		return;
+
+	pit_oneshot (count);
+	pit_rest = to_tick - count;
+	pit_state = PIT_EARLY;
+}
+
+/* Converts NS nanoseconds into TSC cycles. */
+static uint64_t
+ns_to_tsc (uint64_t ns) {
+	return ns / NS_PER_SEC * tsc_hz + ns % NS_PER_SEC * tsc_hz / NS_PER_SEC;
+}
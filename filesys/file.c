@@ -1,29 +1,40 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* Dropped by file_close(). */
 };
 
+/* Cache of open files. */
+static struct kmem_cache file_cache;
+
+/* Initializes the open file cache. */
+void
+file_init (void) {
+	kmem_cache_init (&file_cache, "file", sizeof (struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) {
-	struct file *file = calloc (1, sizeof *file);
+	struct file *file = kmem_cache_alloc (&file_cache);
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
-		free (file);
+		kmem_cache_free (&file_cache, file);
 		return NULL;
 	}
 }
@@ -48,13 +59,25 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Adds a reference to FILE and returns FILE.  The reference is
+ * dropped by file_close(), which only closes FILE for real when
+ * the last reference goes, so a thread can keep using FILE while
+ * another closes it. */
+struct file *
+file_ref (struct file *file) {
+	__atomic_add_fetch (&file->ref_cnt, 1, __ATOMIC_RELAXED);
+	return file;
+}
+
+/* Closes FILE, or drops one reference to it if file_ref() added
+ * others. */
 void
 file_close (struct file *file) {
-	if (file != NULL) {
+	if (file != NULL
+			&& __atomic_sub_fetch (&file->ref_cnt, 1, __ATOMIC_ACQ_REL) == 0) {
 		file_allow_write (file);
 		inode_close (file->inode);
-		free (file);
+		kmem_cache_free (&file_cache, file);
 	}
 }
 
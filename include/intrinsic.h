@@ -119,6 +119,68 @@ static __inline uint64_t rcr2(void) {
 	return val;
 }
 
+/* Reads the time-stamp counter, which counts CPU cycles since
+   reset.  See [IA32-v3b] 17.17 "Time-Stamp Counter". */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Executes CPUID for LEAF, storing the EAX, EBX, ECX, and EDX
+   results into the corresponding pointers. */
+__attribute__((always_inline))
+static __inline void cpuid(uint32_t leaf, uint32_t *a, uint32_t *b,
+		uint32_t *c, uint32_t *d) {
+	__asm __volatile("cpuid"
+			: "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d)
+			: "a" (leaf), "c" (0));
+}
+
+__attribute__((always_inline))
+static __inline uint64_t rcr0(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr0(uint64_t val) {
+	__asm __volatile("movq %0, %%cr0" : : "r" (val));
+}
+
+__attribute__((always_inline))
+static __inline uint64_t rcr4(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr4(uint64_t val) {
+	__asm __volatile("movq %0, %%cr4" : : "r" (val));
+}
+
+/* Clears CR0.TS, allowing FPU instructions without #NM. */
+__attribute__((always_inline))
+static __inline void clts(void) {
+	__asm __volatile("clts");
+}
+
+/* Saves the x87, MMX and SSE state to the 512-byte, 16-byte
+   aligned area at AREA.  See [IA32-v2a] "FXSAVE". */
+__attribute__((always_inline))
+static __inline void fxsave(void *area) {
+	__asm __volatile("fxsave64 (%0)" : : "r" (area) : "memory");
+}
+
+/* Loads the x87, MMX and SSE state saved by fxsave() at AREA. */
+__attribute__((always_inline))
+static __inline void fxrstor(const void *area) {
+	__asm __volatile("fxrstor64 (%0)" : : "r" (area) : "memory");
+}
+
 __attribute__((always_inline))
 static __inline void write_msr(uint32_t ecx, uint64_t val) {
 	uint32_t edx, eax;
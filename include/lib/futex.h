@@ -0,0 +1,31 @@
+#ifndef __LIB_FUTEX_H
+#define __LIB_FUTEX_H
+
+/* Operations of the futex() system call, which blocks and wakes
+   threads waiting on an int in user memory.  User programs build
+   locks on top of it that only enter the kernel when contended;
+   see lib/user/synch.c.
+
+   FUTEX_WAIT (ADDR, VAL)
+     Blocks the caller until woken, but only if *ADDR still
+     equals VAL when checked by the kernel.  Returns 0 after
+     being woken, -1 if *ADDR did not equal VAL.
+
+   FUTEX_WAKE (ADDR, N)
+     Wakes up to N threads waiting on ADDR, highest priority
+     first, and returns the number woken.
+
+   FUTEX_REQUEUE (ADDR, N, ADDR2, N2)
+     Wakes up to N threads waiting on ADDR and moves up to N2 of
+     the rest to wait on ADDR2 instead, without waking them.
+     Returns the number of threads woken or moved.
+
+   Waiters are keyed by the physical location of ADDR, which
+   must be aligned to an int. */
+enum {
+	FUTEX_WAIT,                 /* Block while *ADDR == VAL. */
+	FUTEX_WAKE,                 /* Wake waiters on ADDR. */
+	FUTEX_REQUEUE               /* Wake some, move the rest to ADDR2. */
+};
+
+#endif /* lib/futex.h */
@@ -0,0 +1,76 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+ *
+ * This is a pairing heap: a multiway tree kept in heap order,
+ * where the element at the root always compares least according
+ * to the heap's LESS function.  Insertion and melding are O(1),
+ * and removing the root or any other element is O(log n)
+ * amortized.
+ *
+ * Like lists and hash tables, heaps do not use dynamic
+ * allocation.  Each structure that can potentially be in a heap
+ * must embed a struct heap_elem member, and the heap_entry macro
+ * converts a struct heap_elem back to the structure that
+ * contains it.  Refer to lib/kernel/list.h for a detailed
+ * explanation of the technique.
+ *
+ * Because nothing is allocated, heap operations may be used with
+ * interrupts disabled and from interrupt handlers, provided the
+ * caller serializes access to the heap. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* Leftmost child. */
+	struct heap_elem *next;     /* Next sibling. */
+	struct heap_elem *prev;     /* Previous sibling, or parent if the
+	                               leftmost child, or null if root. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+ * the structure that HEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child     \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A must come out of the
+ * heap before B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Performs some operation on heap element E, given auxiliary
+ * data AUX. */
+typedef void heap_action_func (struct heap_elem *e, void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Least element, or null if empty. */
+	size_t elem_cnt;            /* Number of elements in heap. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and deletion. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+void heap_clear (struct heap *, heap_action_func *, void *aux);
+
+/* Information. */
+struct heap_elem *heap_top (const struct heap *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,23 @@
+#ifndef __LIB_SCHED_STATS_H
+#define __LIB_SCHED_STATS_H
+
+#include <stdint.h>
+
+/* Number of buckets in the wakeup latency histogram.  Bucket N
+   counts wakeups that waited at least 2**N but less than
+   2**(N+1) cycles before running; the last bucket also counts
+   everything longer. */
+#define SCHED_LATENCY_BUCKETS 32
+
+/* Scheduler statistics of one thread, as kept by the kernel and
+   returned by the sched_stats() system call.  Times are in CPU
+   cycles, as counted by the time-stamp counter. */
+struct sched_stats {
+	uint64_t run_time;              /* Time spent running. */
+	uint64_t wait_time;             /* Time spent ready but not running. */
+	uint64_t voluntary_switches;    /* Switched out while blocking or exiting. */
+	uint64_t involuntary_switches;  /* Switched out while still ready. */
+	uint32_t latency[SCHED_LATENCY_BUCKETS]; /* Wakeup-to-run latency. */
+};
+
+#endif /* lib/sched-stats.h */
@@ -36,6 +36,17 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Scheduler instrumentation. */
+	SYS_SCHED_STATS,            /* Get a thread's scheduler statistics. */
+
+	/* User-space synchronization. */
+	SYS_FUTEX,                  /* Wait on or wake a user-space lock. */
+
+	/* User threads. */
+	SYS_THREAD_CREATE,          /* Start a thread in this process. */
+	SYS_THREAD_EXIT,            /* Terminate the calling thread. */
+	SYS_THREAD_JOIN,            /* Wait for a thread of this process. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,35 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutex for threads of user programs.  Acquiring a free mutex
+   and releasing one that nobody waits for never enter the
+   kernel; only contended operations call futex(). */
+struct mutex {
+	int state;                  /* See lib/user/synch.c. */
+};
+
+/* Static initializer for a mutex. */
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable for threads of user programs. */
+struct condvar {
+	int seq;                    /* Bumped by every signal. */
+	struct mutex *mutex;        /* Mutex of the waiters, if any. */
+};
+
+/* Static initializer for a condition variable. */
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <futex.h>
+#include <sched-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +52,23 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Scheduler instrumentation.  sched_stats() copies the statistics
+   of process PID, or of the caller if PID is 0, into *STATS and
+   returns true, or returns false if there is no such process.
+   run_time and wait_time are raw time-stamp counter cycles, not
+   timer ticks or nanoseconds. */
+bool sched_stats (pid_t, struct sched_stats *);
+
+/* User-space synchronization; see <futex.h>. */
+int futex (int *uaddr, int op, int val, int *uaddr2, int val2);
+
+/* User threads.  All threads of a process share its memory and
+   file descriptors; exit() from any of them ends the process. */
+typedef void thread_func (void *aux);
+pid_t thread_create (thread_func *, void *aux);
+void thread_exit (void) NO_RETURN;
+int thread_join (pid_t);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,92 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <heap.h>
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Per-CPU groundwork for multiprocessor support.
+ *
+ * The kernel is still uniprocessor.  What exists is the layout an
+ * SMP kernel needs: scheduler state kept per CPU in struct cpu,
+ * and spin locks around the parts other CPUs would share (the run
+ * queues, the dying-thread list, the page allocator).  Nothing
+ * ever runs on a second CPU:
+ *
+ *   - Application processors are not started: there is no
+ *     real-mode trampoline and no MADT or MP table parsing, so
+ *     cpu_cnt is 1 even under QEMU "-smp N".
+ *
+ *   - Timer interrupts come from the 8254 PIT through the 8259
+ *     PIC.  The local APIC is not programmed and no
+ *     inter-processor interrupts are sent.
+ *
+ *   - Semaphores, locks, condition variables, the timer's sleep
+ *     list and syscall_entry's register save area get mutual
+ *     exclusion from intr_disable() alone, which is only correct
+ *     on one CPU.
+ *
+ * Code may therefore rely on cpu_cnt == 1. */
+
+/* Maximum number of CPUs the kernel keeps state for. */
+#define CPU_MAX 8
+
+/* Per-CPU scheduler state.
+ *
+ * Everything the scheduler used to keep in globals lives here,
+ * one copy per CPU.  The running thread is not stored: each
+ * thread runs on its own kernel stack, so running_thread() in
+ * thread.c already finds it from `rsp', and that thread's `cpu'
+ * member then locates the CPU it runs on (see this_cpu()).
+ *
+ * The run queue is protected by rq_lock, because other CPUs
+ * unblock threads into it.  The remaining members are only
+ * touched by their own CPU, with interrupts off. */
+struct cpu {
+	unsigned id;                /* Index into cpus[]. */
+	struct thread *idle_thread; /* Runs when the run queue is empty. */
+
+	/* Run queue of threads in THREAD_READY state.  Under the
+	   priority schedulers it is one FIFO list per priority, and
+	   bit N of ready_mask is set iff ready_queue[N] is non-empty.
+	   Under "-cfs" it is cfs_queue, a heap ordered by vruntime. */
+	struct spinlock rq_lock;
+	struct list ready_queue[PRI_MAX + 1];
+	uint64_t ready_mask;
+	struct heap cfs_queue;
+	int64_t min_vruntime;       /* Monotonic floor of queued vruntimes. */
+	unsigned long cfs_load;     /* Sum of weights in cfs_queue. */
+	size_t ready_cnt;           /* # of threads in the run queue. */
+
+	/* Threads in the earliest-deadline-first class, which run
+	   before all others whatever the scheduler.  Those with budget
+	   left wait in edf_queue; those that used up their budget wait
+	   in edf_throttled for their next period, and do not count in
+	   ready_cnt.  Both are ordered by deadline. */
+	struct heap edf_queue;
+	struct heap edf_throttled;
+
+	/* Scheduling. */
+	unsigned thread_ticks;      /* # of timer ticks since last yield. */
+	unsigned time_slice;        /* Ticks the running thread may use. */
+
+	/* Thread whose state is in the FPU registers, or null. */
+	struct thread *fpu_owner;
+
+	/* Statistics, written by this CPU under stats_seq and read by
+	   any CPU without a lock. */
+	struct seqlock stats_seq;
+	long long idle_ticks;       /* # of timer ticks spent idle. */
+	long long kernel_ticks;     /* # of timer ticks in kernel threads. */
+	long long user_ticks;       /* # of timer ticks in user programs. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern unsigned cpu_cnt;
+
+struct cpu *this_cpu (void);
+
+#endif /* threads/cpu.h */
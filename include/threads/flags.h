@@ -9,4 +9,11 @@
 #define FLAG_AC    (1<<18)
 #define FLAG_NT    (1<<14)
 
+/* Control register bits. */
+#define CR0_MP     (1<<1)   /* Monitor coprocessor: WAIT honors TS. */
+#define CR0_EM     (1<<2)   /* Emulate x87: all FPU instructions trap. */
+#define CR0_TS     (1<<3)   /* Task switched: next FPU use raises #NM. */
+#define CR4_OSFXSR (1<<9)   /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT (1<<10) /* Unmasked SSE exceptions raise #XF. */
+
 #endif /* threads/flags.h */
@@ -28,6 +28,13 @@
 #define PTX(la)  ((((uint64_t) (la)) >> PTXSHIFT) & 0x1FF)
 #define PTE_ADDR(pte) ((uint64_t) (pte) & ~0xFFF)
 
+/* A page-directory entry with PTE_PS set maps a whole "large
+   page" of LARGE_PGSIZE bytes, aligned on its size, instead of
+   pointing to a page table. */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)  /* Bytes in a large page. */
+#define LARGE_PGCNT (LARGE_PGSIZE / PGSIZE) /* Pages in a large page. */
+#define LARGE_PTE_ADDR(pde) ((uint64_t) (pde) & ~(LARGE_PGSIZE - 1))
+
 /* The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
    ignored.
@@ -41,5 +48,6 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=large page (PDEs only). */
 
 #endif /* threads/pte.h */
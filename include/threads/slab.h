@@ -0,0 +1,41 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Puts freshly carved object OBJ into its constructed state. */
+typedef void kmem_ctor (void *obj);
+
+/* A cache of equally sized objects, carved out of one-page slabs.
+   See slab.c for details. */
+struct kmem_cache {
+	char name[16];              /* For statistics. */
+	size_t obj_size;            /* Size of an object in bytes. */
+	size_t slot_size;           /* Object plus free-list link, aligned. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	kmem_ctor *ctor;            /* Constructor, or null. */
+	struct lock lock;           /* Protects the members below. */
+	struct list partial;        /* Slabs with some objects in use. */
+	struct list empty;          /* Slabs with no objects in use. */
+	size_t empty_cnt;           /* Number of slabs in `empty'. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs owned, full ones included. */
+	size_t active_cnt;          /* Objects in use. */
+	unsigned long long alloc_cnt; /* Calls to kmem_cache_alloc(). */
+	unsigned long long grow_cnt;  /* Pages taken from palloc. */
+	unsigned long long shrink_cnt; /* Pages given back to palloc. */
+
+	struct kmem_cache *next;    /* Next in the list of all caches. */
+};
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+		kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
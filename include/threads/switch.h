@@ -0,0 +1,23 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <debug.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Switches from the running thread to NEXT.  Saves only what the
+   calling convention requires a function to preserve -- rbx, rbp
+   and r12 through r15 -- on the running thread's stack and the
+   stack pointer in *RSP, then hands NEXT to thread_resume().  When
+   the running thread is resumed the call simply returns. */
+void switch_threads (uint64_t *rsp, struct thread *next);
+
+/* Resumes a thread that was suspended in switch_threads() with
+   stack pointer RSP. */
+void switch_resume (uint64_t rsp) NO_RETURN;
+
+/* Resumes NEXT from wherever it left the CPU.  In thread.c. */
+void thread_resume (struct thread *next) NO_RETURN;
+
+#endif /* threads/switch.h */
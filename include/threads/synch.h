@@ -1,43 +1,142 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority
+	                               first, FIFO among equals. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_up_n (struct semaphore *, unsigned n);
+void sema_waiter_update (struct thread *);
+void sema_waiter_cancel (struct thread *);
 void sema_self_test (void);
+void sema_switch_bench (void);
 
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct heap donors;         /* Waiting threads, highest priority first. */
+	struct heap_elem held_elem; /* Element in holder's `held_locks'. */
 };
 
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
+bool lock_acquire_timeout (struct lock *, int64_t ticks);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority
+	                               first, FIFO among equals. */
 };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.
+ *
+ * Any number of readers or a single writer may hold it.  The
+ * writer owns the embedded lock for as long as it writes, so
+ * threads waiting to read or write donate their priority to it.
+ * Readers only hold that lock while they register, and a writer
+ * that is waiting for readers to leave keeps it, so new readers
+ * queue behind the writer instead of starving it.  That writer
+ * in turn donates its priority to every reader in `holders'. */
+struct rwlock {
+	struct lock lock;           /* Held by writer, or reader entering. */
+	unsigned readers;           /* # of threads holding it to read. */
+	struct list holders;        /* Their rwlock_holds. */
+	struct thread *writer;      /* Writer waiting for readers to leave. */
+	struct semaphore drained;   /* Upped by the last reader to leave. */
+};
+
+/* Most reader-writer locks a thread may hold for reading at once. */
+#define RWLOCK_HOLD_MAX 4
+
+/* One thread's read hold on a reader-writer lock, kept in the
+ * thread itself. */
+struct rwlock_hold {
+	struct rwlock *rwlock;      /* Lock held for reading, or null. */
+	unsigned depth;             /* # of nested read acquisitions. */
+	struct thread *thread;      /* Holding thread. */
+	struct list_elem elem;      /* Element in rwlock's `holders'. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Spin lock.
+ *
+ * Busy-waits instead of sleeping, so it may be used where a
+ * thread cannot block: in interrupt handlers and in the
+ * scheduler itself.  Interrupts are disabled on the local CPU
+ * while it is held, which also makes it a drop-in replacement for
+ * an intr_disable()/intr_set_level() pair on one CPU.  Hold it
+ * only briefly, never sleep while holding it, and release nested
+ * spin locks in the reverse order they were acquired. */
+struct spinlock {
+	volatile int locked;        /* Nonzero while held. */
+	struct cpu *holder;         /* CPU holding lock (for debugging). */
+	enum intr_level old_level;  /* Interrupt level to restore. */
+};
+
+void spin_lock_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_lock_held (const struct spinlock *);
+
+/* Sequence lock.
+ *
+ * Protects data that is read often and written rarely, such as
+ * counters updated by the timer interrupt.  Readers take no lock:
+ * they read the data between seqlock_read_begin() and
+ * seqlock_read_retry() and start over if a writer got in the way,
+ * as in
+ *
+ *     do {
+ *         start = seqlock_read_begin (&seq);
+ *         copy = data;
+ *     } while (seqlock_read_retry (&seq, start));
+ *
+ * The sequence is odd while a write is in progress.  Readers must
+ * not follow pointers read this way, since the data may be torn
+ * until the retry check passes. */
+struct seqlock {
+	volatile unsigned sequence; /* Incremented by each write's start and end. */
+	struct spinlock lock;       /* Serializes writers. */
+};
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
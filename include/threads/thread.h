@@ -2,7 +2,9 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <sched-stats.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 
@@ -92,11 +94,9 @@ typedef int tid_t;
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+ * the run queue, or, once the thread has died, an element in the
+ * destruction request list (both in thread.c).  Semaphores keep
+ * their waiters in a heap through `wait_elem' instead (synch.c). */
 struct thread
 {
 	/* Owned by thread.c. */
@@ -104,21 +104,55 @@ struct thread
 	enum thread_status status; /* Thread state. */
 	char name[16];			   /* Name (for debugging purposes). */
 
-	int64_t wakeup;
+	int64_t wakeup;				 /* Tick to wake up at, if sleeping. */
+	bool sleeping;				 /* In the sleep queue. */
+	struct heap_elem sleep_elem; /* Element in the sleep queue. */
 
 	int priority; /* Priority. */
 
 	int init_priority;				// 스레드의 원래 우선순위 저장
-	struct list donations;			// 이 스레드에게 우선순위를 기부한 스레드들의 리스트
-	struct list_elem donation_elem; // donations 리스트에 사용될 리스트 요소
+	struct heap held_locks;			// 보유한 lock들, 기부받는 우선순위가 높은 순
+	struct heap_elem donation_elem; // wait_on_lock의 donors 힙에 사용될 요소
 	struct lock *wait_on_lock;		// 스레드가 현재 대기 중인 lock의 주소
 
+	/* Owned by synch.c. */
+	struct semaphore *wait_on_sema;	  /* Semaphore waited for, if any. */
+	struct heap_elem wait_elem;		  /* Element in its `waiters'. */
+	uint64_t wait_seq;				  /* When the wait started. */
+	struct condition *wait_cond;	  /* Condition waited for, if any. */
+	struct heap_elem *wait_cond_elem; /* Element in its `waiters'. */
+	struct rwlock *wait_on_rwlock;	  /* Waiting for its readers, if any. */
+	struct rwlock_hold read_holds[RWLOCK_HOLD_MAX]; /* Held to read. */
+
 	int nice;
 	int recent_cpu;
+	int64_t mlfqs_epoch; /* Second at which recent_cpu was last decayed. */
+	struct list_elem mlfqs_elem; /* In mlfqs_blocked[], while blocked. */
+	bool mlfqs_blocked;			 /* Is `mlfqs_elem' in a list? */
+
+	int64_t vruntime;			/* Weighted CPU time, for "-cfs". */
+	struct heap_elem cfs_elem; /* Element in a CFS run queue. */
+
+	/* Earliest-deadline-first class; see thread_set_deadline(). */
+	int64_t edf_period;		   /* Ticks per period, or 0 if not EDF. */
+	int64_t edf_budget;		   /* Ticks of CPU time per period. */
+	int64_t edf_deadline;	   /* Tick at which the current period ends. */
+	int64_t edf_remaining;	   /* Budget left in the current period. */
+	struct heap_elem edf_elem; /* Element in an EDF run queue. */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem; /* List element. */
 
+	struct cpu *cpu; /* CPU this thread runs or is queued on. */
+
+	/* Scheduler statistics; see thread_get_sched_stats(). */
+	struct sched_stats sched_stats;
+	uint64_t ready_since; /* TSC when last made ready. */
+	uint64_t run_since;	  /* TSC when last switched in. */
+	bool woken;			  /* Made ready by thread_unblock(). */
+
+	void *fpu_mem; /* FXSAVE area, or null if never used the FPU. */
+
 	struct list_elem allelem; /* List element. */
 
 #ifdef USERPROG
@@ -140,6 +174,17 @@ struct thread
 	struct semaphore exit_sema; // 자식 프로세스 종료 signal
 	struct semaphore wait_sema; // exit_sema를 기다릴 때 사용
 
+	/* Threads of a process share the address space, file
+	   descriptors and exit status of its first thread, the
+	   leader.  The members below marked "leader" are only used in
+	   the leader; see process_thread_create(). */
+	struct thread *leader;		  /* Leader of this thread's process. */
+	struct lock proc_lock;		  /* Leader: protects the members below. */
+	struct list members;		  /* Leader: other threads of the process. */
+	struct list_elem member_elem; /* Element in leader's `members'. */
+	bool exiting;				  /* Leader: process is exiting. */
+	uint32_t stack_map;			  /* Leader: bitmap of user stacks in use. */
+	int stack_slot;				  /* Index of this thread's user stack. */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
@@ -148,6 +193,7 @@ struct thread
 
 	/* Owned by thread.c. */
 	struct intr_frame tf; /* Information for switching */
+	uint64_t switch_rsp;  /* Saved rsp, if suspended in switch_threads(). */
 	unsigned magic;		  /* Detects stack overflow. */
 };
 
@@ -156,11 +202,22 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which orders
+   threads by weighted virtual runtime and uses `nice' as the
+   weight.  Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
+/* If true, switch threads through a full intr_frame and iretq
+   instead of switch_threads(). */
+extern bool thread_iret_switch;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_credit_idle_ticks(int64_t);
 void thread_print_stats(void);
+bool thread_get_sched_stats(tid_t, struct sched_stats *);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
@@ -178,6 +235,8 @@ void thread_yield(void);
 int thread_get_priority(void);
 void thread_set_priority(int);
 
+bool thread_set_deadline(int64_t period, int64_t budget);
+
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
@@ -185,15 +244,33 @@ int thread_get_load_avg(void);
 
 void do_iret(struct intr_frame *tf);
 
+bool thread_fpu_acquire(void);
+bool thread_fpu_fork(struct thread *parent);
+void thread_fpu_release(void);
+
 /** #Project 1: Alarm Clock **/
 void thread_sleep(int64_t ticks);
 void thread_awake(int64_t ticks);
+int64_t thread_next_wakeup(void);
+void thread_timeout_start(int64_t ticks);
+bool thread_timeout_expired(void);
+void thread_timeout_cancel(void);
 
 /** #Project 1: Priority Scheduling **/
-bool thread_priority_compare(const struct list_elem *a, const struct list_elem *b, void *aux);
-bool thread_compare_donate_priority(const struct list_elem *l, const struct list_elem *s, void *aux UNUSED);
-void donate_priority(void);
+bool thread_compare_donate_priority(const struct heap_elem *l, const struct heap_elem *s, void *aux UNUSED);
+void donate_priority(struct lock *lock);
+void receive_donation(struct lock *lock);
+void cancel_donation(struct lock *lock);
 void remove_with_lock(struct lock *lock);
-void refresh_priority(void);
+void donate_to_readers(struct rwlock *rwlock);
+void refresh_priority(struct thread *t);
+void thread_test_preemption(void);
+
+/** #Project 1: MLFQS **/
+void mlfqs_calculate_priority(struct thread *t);
+void mlfqs_calculate_load_avg(void);
+void mlfqs_increment_recent_cpu(void);
+void mlfqs_recalculate_recent_cpu(void);
+void mlfqs_recalculate_priority(void);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,63 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <heap.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+struct work;
+
+/* Function run by a worker thread for work item W. */
+typedef void work_func (struct work *w);
+
+/* States of a work item. */
+enum work_state {
+	WORK_IDLE,                  /* Not queued; may be running. */
+	WORK_PENDING,               /* Queued, waiting for a worker. */
+	WORK_RUNNING,               /* Claimed by a worker, not yet run. */
+	WORK_DELAYED                /* Waiting for its timer to expire. */
+};
+
+/* A unit of deferred work.  Embed it in the structure the work
+   is about, like a list_elem, and recover that structure in FUNC
+   with list_entry-style offset arithmetic or through AUX. */
+struct work {
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* For FUNC's use. */
+	enum work_state state;      /* Owned by workqueue.c. */
+	struct workqueue *wq;       /* Queue the item was last queued on. */
+	struct list_elem elem;      /* Element in a pending list or batch. */
+	struct heap_elem timer_elem; /* Element in a delayed-work heap. */
+	int64_t due;                /* Tick at which delayed work is queued. */
+};
+
+/* A queue of work items, served by its own worker threads. */
+struct workqueue {
+	char name[16];              /* Name of the worker threads. */
+	struct spinlock lock;       /* Protects the members below. */
+	struct list pending;        /* Queued work, in FIFO order. */
+	struct heap delayed;        /* Delayed work, earliest first. */
+	struct semaphore work_cnt;  /* Up once for each queued item. */
+	size_t batch;               /* Most items a worker takes at once. */
+	unsigned busy_cnt;          /* # of workers running items. */
+	struct list flushers;       /* Threads in workqueue_flush(). */
+	struct workqueue *next;     /* Next in the list of all queues. */
+};
+
+void workqueue_init (struct workqueue *, const char *name, int priority,
+		unsigned worker_cnt, size_t batch);
+void work_init (struct work *, work_func *, void *aux);
+
+bool workqueue_queue (struct workqueue *, struct work *);
+bool workqueue_queue_delayed (struct workqueue *, struct work *,
+		int64_t ticks);
+bool workqueue_cancel (struct work *);
+void workqueue_flush (struct workqueue *);
+
+void workqueue_timer (int64_t now);
+int64_t workqueue_next_due (void);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,16 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <futex.h>
+#include <stdint.h>
+
+struct thread;
+
+void futex_init (void);
+int futex_wait (uint64_t *pml4, int *uaddr, int val);
+int futex_wake (uint64_t *pml4, int *uaddr, int n);
+int futex_requeue (uint64_t *pml4, int *uaddr, int n,
+		int *uaddr2, int n2);
+void futex_wake_process (struct thread *leader);
+
+#endif /* userprog/futex.h */
@@ -17,6 +17,14 @@ void argument_stack(char **argv, int argc, struct intr_frame *if_);
 struct thread *get_child_process(int pid);
 int process_add_file(struct file *f);
 struct file *process_get_file(int fd);
-int process_close_file(int fd);
+struct file *process_close_file(int fd);
+
+/** User threads **/
+tid_t process_thread_create(void *start, void *func, void *aux);
+void process_thread_exit(void) NO_RETURN;
+int process_thread_join(tid_t tid);
+bool process_mark_exiting(int status);
+void process_check_exit(void);
+bool process_single_threaded(void);
 
 #endif /* userprog/process.h */
\ No newline at end of file
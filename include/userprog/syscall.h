@@ -2,6 +2,7 @@
 #define USERPROG_SYSCALL_H
 
 #include <stdbool.h>
+#include <sched-stats.h>
 
 void syscall_init(void);
 
@@ -25,5 +26,7 @@ int write(int fd, const void *buffer, unsigned length);
 void seek(int fd, unsigned position);
 int tell(int fd);
 void close(int fd);
+bool sched_stats(pid_t pid, struct sched_stats *stats);
+int futex(int *uaddr, int op, int val, int *uaddr2, int val2);
 
 #endif /* userprog/syscall.h */
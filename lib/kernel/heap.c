@@ -0,0 +1,205 @@
+/* Pairing heap.
+
+   See heap.h for basic information.  The two-pass pairing used
+   by merge_pairs() is done iteratively, because kernel stacks
+   are too small to recurse once per child. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *,
+		struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void detach (struct heap_elem *);
+
+/* Initializes H as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into H.  E must not already be in a heap. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+	h->elem_cnt++;
+}
+
+/* Removes and returns the least element of H, which must not be
+   empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top;
+
+	ASSERT (!heap_empty (h));
+
+	top = h->root;
+	h->root = merge_pairs (h, top->child);
+	h->elem_cnt--;
+	top->child = NULL;
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		heap_pop (h);
+		return;
+	}
+
+	detach (e);
+	h->root = meld (h, h->root, merge_pairs (h, e->child));
+	h->elem_cnt--;
+	e->child = NULL;
+}
+
+/* Restores heap order after the key of E, which must be in H,
+   has changed in either direction. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	heap_remove (h, e);
+	heap_push (h, e);
+}
+
+/* Removes every element from H, calling ACTION on each with AUX,
+   in no particular order.  Takes O(n) time, where popping the
+   elements one by one would take O(n log n).  H is already empty
+   when ACTION is first called, and ACTION may do anything with
+   the element it is given, including pushing it onto H again. */
+void
+heap_clear (struct heap *h, heap_action_func *action, void *aux) {
+	struct heap_elem *todo;
+
+	ASSERT (h != NULL);
+	ASSERT (action != NULL);
+
+	todo = h->root;
+	h->root = NULL;
+	h->elem_cnt = 0;
+
+	/* TODO is a list of subtrees, linked through `next'. */
+	while (todo != NULL) {
+		struct heap_elem *e = todo;
+
+		todo = e->next;
+		if (e->child != NULL) {
+			struct heap_elem *last = e->child;
+
+			while (last->next != NULL)
+				last = last->next;
+			last->next = todo;
+			todo = e->child;
+		}
+		e->child = e->next = e->prev = NULL;
+		action (e, aux);
+	}
+}
+
+/* Returns the least element of H, or a null pointer if H is
+   empty.  The element stays in H. */
+struct heap_elem *
+heap_top (const struct heap *h) {
+	ASSERT (h != NULL);
+	return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) {
+	ASSERT (h != NULL);
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (const struct heap *h) {
+	ASSERT (h != NULL);
+	return h->root == NULL;
+}
+
+/* Melds the heap-ordered trees rooted at A and B, neither of
+   which may have siblings, and returns the root of the result. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (h->less (b, a, h->aux)) {
+		struct heap_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* Make B the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree
+   and returns its root: first pairs neighbours from left to
+   right, then folds the pairs together from right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL) {
+			b->next = b->prev = NULL;
+			a = meld (h, a, b);
+		}
+
+		/* Stack the pair, reusing `next' as the link. */
+		a->next = pairs;
+		pairs = a;
+	}
+
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Unlinks non-root element E, together with its subtree, from
+   its parent's child list. */
+static void
+detach (struct heap_elem *e) {
+	ASSERT (e->prev != NULL);
+
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+}
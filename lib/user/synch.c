@@ -0,0 +1,133 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Mutexes and condition variables for user programs, built on
+   the futex() system call.
+
+   A mutex's state is 0 when it is free, 1 when it is held and
+   nobody waits for it, and 2 when it is held and there may be
+   waiters.  Only a thread that finds the mutex held sleeps in
+   the kernel, and only an unlock that finds state 2 calls the
+   kernel to wake a waiter.  See Ulrich Drepper, "Futexes Are
+   Tricky", for why the third state is needed.
+
+   A condition variable is a sequence number.  A waiter samples
+   it before releasing the mutex and sleeps only while it is
+   unchanged, so a signal that arrives between releasing the
+   mutex and sleeping is not lost. */
+
+/* Atomically replaces *P by NEW and returns its old value. */
+static inline int
+atomic_xchg (int *p, int new) {
+	return __atomic_exchange_n (p, new, __ATOMIC_ACQUIRE);
+}
+
+/* Atomically replaces *P by NEW if it equals OLD.  Returns the
+   value *P had before. */
+static inline int
+atomic_cmpxchg (int *p, int old, int new) {
+	__atomic_compare_exchange_n (p, &old, new, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	return old;
+}
+
+/* Initializes M as a free mutex. */
+void
+mutex_init (struct mutex *m) {
+	m->state = 0;
+}
+
+/* Acquires M, sleeping until it is free if necessary.  M must
+   not already be held by the calling thread. */
+void
+mutex_lock (struct mutex *m) {
+	int c = atomic_cmpxchg (&m->state, 0, 1);
+
+	if (c == 0)
+		return;
+
+	/* Contended: announce a waiter, then sleep until we are the
+	   one that finds the mutex free.  We cannot tell whether
+	   others still wait, so we take it in state 2. */
+	if (c != 2)
+		c = atomic_xchg (&m->state, 2);
+	while (c != 0) {
+		futex (&m->state, FUTEX_WAIT, 2, NULL, 0);
+		c = atomic_xchg (&m->state, 2);
+	}
+}
+
+/* Acquires M if it is free, without sleeping.  Returns true if
+   successful, false otherwise. */
+bool
+mutex_trylock (struct mutex *m) {
+	return atomic_cmpxchg (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the calling thread must hold, and wakes one
+   of its waiters, if any. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_fetch_sub (&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&m->state, 0, __ATOMIC_RELEASE);
+		futex (&m->state, FUTEX_WAKE, 1, NULL, 0);
+	}
+}
+
+/* Initializes condition variable CV. */
+void
+condvar_init (struct condvar *cv) {
+	cv->seq = 0;
+	cv->mutex = NULL;
+}
+
+/* Atomically releases M and waits for CV to be signaled, then
+   reacquires M before returning.  M must be held, and all
+   waiters on CV must use the same mutex.
+
+   As with the kernel's cond_wait(), a wakeup is only a hint
+   that the condition may hold, so callers should recheck it in
+   a loop. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m) {
+	int seq = __atomic_load_n (&cv->seq, __ATOMIC_RELAXED);
+
+	cv->mutex = m;
+	mutex_unlock (m);
+	futex (&cv->seq, FUTEX_WAIT, seq, NULL, 0);
+
+	/* condvar_broadcast() may have moved us to M's queue, so
+	   others may be waiting on M: take it in state 2. */
+	while (atomic_xchg (&m->state, 2) != 0)
+		futex (&m->state, FUTEX_WAIT, 2, NULL, 0);
+}
+
+/* Wakes one thread waiting on CV, if any.  The caller should
+   hold the waiters' mutex. */
+void
+condvar_signal (struct condvar *cv) {
+	__atomic_fetch_add (&cv->seq, 1, __ATOMIC_RELEASE);
+	futex (&cv->seq, FUTEX_WAKE, 1, NULL, 0);
+}
+
+/* Wakes all threads waiting on CV.  Only one of them can take
+   the mutex, so the rest are moved to wait on the mutex instead
+   of all being woken at once.  The caller should hold the
+   waiters' mutex. */
+void
+condvar_broadcast (struct condvar *cv) {
+	struct mutex *m = cv->mutex;
+
+	__atomic_fetch_add (&cv->seq, 1, __ATOMIC_RELEASE);
+	if (m == NULL)
+		return;
+
+	/* Mark M contended, so that unlocking it wakes the waiters we
+	   move.  If M is free, because the caller does not hold it,
+	   nobody would unlock it, so wake everyone instead. */
+	if (atomic_cmpxchg (&m->state, 1, 2) == 0)
+		futex (&cv->seq, FUTEX_WAKE, INT_MAX, NULL, 0);
+	else
+		futex (&cv->seq, FUTEX_REQUEUE, 1, &m->state, INT_MAX);
+}
@@ -194,3 +194,37 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+bool
+sched_stats (pid_t pid, struct sched_stats *stats) {
+	return syscall2 (SYS_SCHED_STATS, pid, stats);
+}
+
+int
+futex (int *uaddr, int op, int val, int *uaddr2, int val2) {
+	return syscall5 (SYS_FUTEX, uaddr, op, val, uaddr2, val2);
+}
+
+/* Runs FUNC (AUX) as the body of a thread started by
+   thread_create(), then exits the thread. */
+static void
+thread_start (thread_func *func, void *aux) {
+	func (aux);
+	thread_exit ();
+}
+
+pid_t
+thread_create (thread_func *func, void *aux) {
+	return syscall3 (SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+void
+thread_exit (void) {
+	syscall0 (SYS_THREAD_EXIT);
+	NOT_REACHED ();
+}
+
+int
+thread_join (pid_t tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
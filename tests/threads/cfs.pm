@@ -0,0 +1,59 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Load weight of each nice value from -20 to 19, as in thread.c.
+our (@cfs_nice_to_weight) = (
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906,
+    3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423,
+    335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45,
+    36, 29, 23, 18, 15);
+
+# Returns the ticks that threads with the given nice values
+# should receive out of TICKS, in proportion to their weights.
+sub cfs_expected_ticks {
+    my ($ticks, @nice) = @_;
+    my (@weight) = map ($cfs_nice_to_weight[$_ + 20], @nice);
+    my ($total) = 0;
+    $total += $_ foreach @weight;
+    return map ($ticks * $_ / $total, @weight);
+}
+
+sub check_cfs_shares {
+    my ($nice, $ticks, $maxdiff) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (@actual);
+    local ($_);
+    foreach (@output) {
+	my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+	$actual[$id] = $count;
+    }
+
+    my (@expected) = cfs_expected_ticks ($ticks, @$nice);
+    my ($ok) = 1;
+    for my $i (0...$#$nice) {
+	$ok = 0
+	  if !defined ($actual[$i])
+	    || abs ($actual[$i] - $expected[$i]) > $maxdiff + .01;
+    }
+    pass if $ok;
+
+    print "Some tick counts were missing or differed from those "
+      . "expected by more than $maxdiff.\n";
+    printf "%6s %4s %8s %8s\n", "thread", "nice", "actual", "expected";
+    for my $i (0...$#$nice) {
+	printf "%6d %4d %8s %8.1f\n", $i, $nice->[$i],
+	  defined ($actual[$i]) ? $actual[$i] : 'undef', $expected[$i];
+    }
+    fail;
+}
+
+1;
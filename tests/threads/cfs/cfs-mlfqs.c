@@ -0,0 +1,13 @@
+/* Run with both -mlfqs and -cfs, which the kernel must refuse
+   with a PANIC while it parses its options, before it runs any
+   test.  Getting here at all is a failure. */
+
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+
+void
+test_cfs_mlfqs (void) 
+{
+  fail ("kernel accepted -mlfqs together with -cfs");
+}
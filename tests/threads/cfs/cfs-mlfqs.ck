@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+fail "Kernel ran with both -mlfqs and -cfs.\n"
+  if grep (/^\(cfs-mlfqs\) begin$/, @output);
+fail "Kernel did not panic on -mlfqs with -cfs.\n"
+  if !grep (/Kernel PANIC .*: -mlfqs and -cfs are mutually exclusive$/,
+	    @output);
+pass;
@@ -0,0 +1,106 @@
+/* Checks that under the completely fair scheduler a thread that
+   wakes up from timer_sleep() runs at once, even though two
+   CPU-bound threads keep the CPU busy and the sleeper has a
+   lower weight than they do.  Each time it wakes up, the sleeper
+   is placed behind the CPU-bound threads' virtual runtime, so it
+   preempts whichever of them is running instead of waiting for
+   its time slice to end.  The CPU-bound threads must still make
+   progress in between. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPINNER_CNT 2
+#define WAKEUP_CNT 50
+
+/* Set to stop the spinners. */
+static volatile bool done;
+
+/* Ticks seen by each spinner. */
+static int spinner_ticks[SPINNER_CNT];
+
+/* Worst wakeup latency of the sleeper, in ticks. */
+static int64_t max_latency;
+
+/* Upped by each thread when it finishes. */
+static struct semaphore finished;
+
+static thread_func spinner, sleeper;
+
+void
+test_cfs_sleeper (void) 
+{
+  int i;
+
+  ASSERT (thread_cfs);
+
+  sema_init (&finished, 0);
+  done = false;
+  max_latency = 0;
+  for (i = 0; i < SPINNER_CNT; i++)
+    {
+      char name[16];
+
+      spinner_ticks[i] = 0;
+      snprintf (name, sizeof name, "spinner %d", i);
+      thread_create (name, PRI_DEFAULT, spinner, &spinner_ticks[i]);
+    }
+  thread_create ("sleeper", PRI_DEFAULT, sleeper, NULL);
+
+  /* Wait for the sleeper, then stop the spinners. */
+  sema_down (&finished);
+  done = true;
+  for (i = 0; i < SPINNER_CNT; i++)
+    sema_down (&finished);
+
+  msg ("Sleeper woke up %d times.", WAKEUP_CNT);
+  if (max_latency > 1)
+    fail ("Sleeper waited up to %lld ticks to run after waking up.",
+          (long long) max_latency);
+  msg ("Sleeper always ran within 1 tick of waking up.");
+  for (i = 0; i < SPINNER_CNT; i++)
+    if (spinner_ticks[i] > 0)
+      msg ("Spinner %d ran.", i);
+    else
+      fail ("Spinner %d never ran.", i);
+}
+
+static void
+spinner (void *ticks_) 
+{
+  int *ticks = ticks_;
+  int64_t last_time = 0;
+
+  while (!done) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        (*ticks)++;
+      last_time = cur_time;
+    }
+  sema_up (&finished);
+}
+
+static void
+sleeper (void *aux UNUSED) 
+{
+  int i;
+
+  thread_set_nice (5);
+  for (i = 0; i < WAKEUP_CNT; i++) 
+    {
+      int64_t duration = i % 3 + 1;
+      int64_t wakeup = timer_ticks () + duration;
+      int64_t latency;
+
+      timer_sleep (duration);
+      latency = timer_ticks () - wakeup;
+      if (latency > max_latency)
+        max_latency = latency;
+    }
+  sema_up (&finished);
+}
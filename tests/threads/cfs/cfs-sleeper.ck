@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cfs-sleeper) begin
+(cfs-sleeper) Sleeper woke up 50 times.
+(cfs-sleeper) Sleeper always ran within 1 tick of waking up.
+(cfs-sleeper) Spinner 0 ran.
+(cfs-sleeper) Spinner 1 ran.
+(cfs-sleeper) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Checks that thread_set_deadline() rejects invalid parameters
+   and keeps the total utilization of the EDF class at or below
+   1, counting a thread's own share only once and releasing it
+   when the thread leaves the class. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func admit_thread;
+static struct semaphore done_sema;
+
+static void
+try_deadline (int64_t period, int64_t budget) 
+{
+  msg ("%s: period %"PRId64", budget %"PRId64": %s", thread_name (),
+       period, budget,
+       thread_set_deadline (period, budget) ? "admitted" : "rejected");
+}
+
+void
+test_edf_admit (void) 
+{
+  try_deadline (10, 0);
+  try_deadline (10, 11);
+  try_deadline (-1, 1);
+  try_deadline (10, 5);
+  try_deadline (10, 10);
+  try_deadline (10, 5);
+
+  sema_init (&done_sema, 0);
+  thread_create ("helper", PRI_DEFAULT, admit_thread, NULL);
+  sema_down (&done_sema);
+
+  try_deadline (10, 10);
+  try_deadline (0, 0);
+  try_deadline (1, 1);
+  try_deadline (0, 0);
+}
+
+static void
+admit_thread (void *aux UNUSED) 
+{
+  try_deadline (4, 3);
+  try_deadline (4, 2);
+  try_deadline (10, 6);
+  try_deadline (0, 0);
+  sema_up (&done_sema);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) main: period 10, budget 0: rejected
+(edf-admit) main: period 10, budget 11: rejected
+(edf-admit) main: period -1, budget 1: rejected
+(edf-admit) main: period 10, budget 5: admitted
+(edf-admit) main: period 10, budget 10: admitted
+(edf-admit) main: period 10, budget 5: admitted
+(edf-admit) helper: period 4, budget 3: rejected
+(edf-admit) helper: period 4, budget 2: admitted
+(edf-admit) helper: period 10, budget 6: rejected
+(edf-admit) helper: period 0, budget 0: admitted
+(edf-admit) main: period 10, budget 10: admitted
+(edf-admit) main: period 0, budget 0: admitted
+(edf-admit) main: period 1, budget 1: admitted
+(edf-admit) main: period 0, budget 0: admitted
+(edf-admit) end
+EOF
+pass;
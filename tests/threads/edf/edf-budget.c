@@ -0,0 +1,76 @@
+/* Checks that an EDF thread that never blocks is throttled to its
+   budget.  A thread with a budget of 3 ticks in every 10 spins
+   next to the main thread, which has no deadline, for 3 seconds.
+   Each thread counts the distinct timer ticks it sees while it
+   runs.  The EDF thread should see about 30% of them, and must
+   see no more than 40%, leaving the main thread at least 60%.
+   Without a budget the EDF thread would starve the main thread
+   entirely. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define RUN_TICKS (3 * TIMER_FREQ)
+
+static thread_func edf_thread;
+static int64_t end_time;
+static struct semaphore done_sema;
+static int edf_ticks;
+
+static int
+count_ticks (void) 
+{
+  int64_t last = timer_ticks ();
+  int cnt = 0;
+
+  while (last < end_time)
+    {
+      int64_t now = timer_ticks ();
+      if (now != last)
+        {
+          last = now;
+          cnt++;
+        }
+    }
+  return cnt;
+}
+
+void
+test_edf_budget (void) 
+{
+  int main_ticks;
+  int total;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+  end_time = timer_ticks () + RUN_TICKS;
+  thread_create ("edf", PRI_DEFAULT, edf_thread, NULL);
+  main_ticks = count_ticks ();
+  sema_down (&done_sema);
+
+  total = main_ticks + edf_ticks;
+  if (total < RUN_TICKS * 9 / 10)
+    fail ("only %d of %d ticks counted", total, RUN_TICKS);
+  if (edf_ticks * 10 > total * 4)
+    fail ("EDF thread saw %d of %d ticks, more than its budget",
+          edf_ticks, total);
+  if (edf_ticks * 10 < total * 2)
+    fail ("EDF thread saw only %d of %d ticks", edf_ticks, total);
+  msg ("EDF thread kept to its budget.");
+}
+
+static void
+edf_thread (void *aux UNUSED) 
+{
+  if (!thread_set_deadline (10, 3))
+    fail ("thread_set_deadline (10, 3) failed");
+  edf_ticks = count_ticks ();
+  thread_set_deadline (0, 0);
+  sema_up (&done_sema);
+}
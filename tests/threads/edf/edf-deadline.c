@@ -0,0 +1,125 @@
+/* Measures deadline misses of EDF threads under background load.
+
+   Three periodic threads, with periods of 10, 20, and 40 ticks
+   and budgets of 3, 5, and 8 ticks, for a total utilization of
+   75%, each do half a budget's worth of work at the start of
+   every period, then sleep until the next one.  Two threads at
+   PRI_MAX spin the whole time.  A period is missed if its work
+   is not done by the time the next one starts.  No period should
+   be missed: EDF threads run ahead of every thread outside the
+   class, and the admitted load is schedulable. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of the test, in ticks. */
+#define RUN_TICKS (4 * TIMER_FREQ)
+
+struct periodic
+  {
+    const char *name;
+    int64_t period;             /* Ticks. */
+    int64_t budget;             /* Ticks. */
+    int missed;                 /* # of missed periods. */
+  };
+
+static struct periodic periodics[] =
+  {
+    {"edf 10/3", 10, 3, 0},
+    {"edf 20/5", 20, 5, 0},
+    {"edf 40/8", 40, 8, 0},
+  };
+
+#define PERIODIC_CNT (sizeof periodics / sizeof *periodics)
+
+static thread_func periodic_thread;
+static void spin_ticks (int);
+static thread_func hog_thread;
+static struct semaphore done_sema;
+static int periodic_left;
+
+void
+test_edf_deadline (void) 
+{
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+  periodic_left = PERIODIC_CNT;
+
+  /* Run at PRI_MAX ourselves so that creating the hogs does not
+     hand them the CPU before every thread has been created. */
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < PERIODIC_CNT; i++)
+    thread_create (periodics[i].name, PRI_MAX, periodic_thread,
+                   &periodics[i]);
+  thread_create ("hog 1", PRI_MAX, hog_thread, NULL);
+  thread_create ("hog 2", PRI_MAX, hog_thread, NULL);
+
+  for (i = 0; i < PERIODIC_CNT + 2; i++)
+    sema_down (&done_sema);
+
+  for (i = 0; i < PERIODIC_CNT; i++)
+    msg ("%s: %d of %d periods missed.", periodics[i].name,
+         periodics[i].missed, (int) (RUN_TICKS / periodics[i].period));
+  thread_set_priority (PRI_DEFAULT);
+}
+
+static void
+periodic_thread (void *p_) 
+{
+  struct periodic *p = p_;
+  int64_t release;
+  int i;
+
+  if (!thread_set_deadline (p->period, p->budget))
+    fail ("%s not admitted", p->name);
+
+  release = timer_ticks ();
+  for (i = 0; i < RUN_TICKS / p->period; i++) 
+    {
+      spin_ticks (p->budget / 2);
+      if (timer_ticks () > release + p->period)
+        p->missed++;
+
+      release += p->period;
+      if (release > timer_ticks ())
+        timer_sleep (release - timer_ticks ());
+    }
+
+  thread_set_deadline (0, 0);
+  periodic_left--;
+  sema_up (&done_sema);
+}
+
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (periodic_left > 0)
+    barrier ();
+  sema_up (&done_sema);
+}
+
+/* Spins until the timer has ticked CNT times while this thread
+   was running, which takes about CNT ticks of CPU time. */
+static void
+spin_ticks (int cnt) 
+{
+  int64_t last = timer_ticks ();
+
+  while (cnt > 0)
+    {
+      int64_t now = timer_ticks ();
+      if (now != last)
+        {
+          last = now;
+          cnt--;
+        }
+    }
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) edf 10/3: 0 of 40 periods missed.
+(edf-deadline) edf 20/5: 0 of 20 periods missed.
+(edf-deadline) edf 40/8: 0 of 10 periods missed.
+(edf-deadline) end
+EOF
+pass;
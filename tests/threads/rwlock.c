@@ -0,0 +1,83 @@
+/* The main thread holds a reader-writer lock for reading while
+   another reader shares it.  A higher-priority writer then blocks
+   waiting for the main thread to stop reading, and donates its
+   priority to it.  A still higher-priority reader that blocks
+   behind the writer donates, through the writer, to the main
+   thread as well, so a medium-priority thread cannot run ahead of
+   any of them.  When the main thread stops reading, the writer
+   runs first, then the reader, then the medium-priority thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+static thread_func medium_thread_func;
+
+void
+test_rwlock (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("reader1", PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+  msg ("reader1 must already have finished.");
+
+  thread_create ("writer", PRI_DEFAULT + 10, writer_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+  thread_create ("reader2", PRI_DEFAULT + 20, reader_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 20, thread_get_priority ());
+  thread_create ("medium", PRI_DEFAULT + 5, medium_thread_func, NULL);
+
+  /* A nested read must not wait for the writer. */
+  rwlock_acquire_read (&rwlock);
+  msg ("Acquired the read lock again.");
+  rwlock_release_read (&rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 20, thread_get_priority ());
+
+  rwlock_release_read (&rwlock);
+  msg ("writer, reader2, medium must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_read (rwlock);
+  msg ("%s: got the read lock", thread_name ());
+  rwlock_release_read (rwlock);
+  msg ("%s: done", thread_name ());
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the write lock");
+  rwlock_release_write (rwlock);
+  msg ("writer: done");
+}
+
+static void
+medium_thread_func (void *aux UNUSED) 
+{
+  msg ("medium: done");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock) begin
+(rwlock) reader1: got the read lock
+(rwlock) reader1: done
+(rwlock) reader1 must already have finished.
+(rwlock) This thread should have priority 41.  Actual priority: 41.
+(rwlock) This thread should have priority 51.  Actual priority: 51.
+(rwlock) Acquired the read lock again.
+(rwlock) This thread should have priority 51.  Actual priority: 51.
+(rwlock) writer: got the write lock
+(rwlock) reader2: got the read lock
+(rwlock) reader2: done
+(rwlock) writer: done
+(rwlock) medium: done
+(rwlock) writer, reader2, medium must already have finished, in that order.
+(rwlock) This thread should have priority 31.  Actual priority: 31.
+(rwlock) end
+EOF
+pass;
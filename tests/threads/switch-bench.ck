@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $path ("iretq", "switch_threads") {
+    fail "No timing for switches via $path.\n"
+      if !grep (/^Thread switch via $path: \d+ cycles$/, @output);
+}
+fail "Benchmark did not finish.\n" if !grep (/^\(switch-bench\) PASS$/, @output);
+pass;
@@ -38,6 +38,20 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"edf-admit", test_edf_admit},
+    {"edf-budget", test_edf_budget},
+    {"edf-deadline", test_edf_deadline},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-nice-3", test_cfs_nice_3},
+    {"cfs-sleeper", test_cfs_sleeper},
+    {"cfs-mlfqs", test_cfs_mlfqs},
+    {"workqueue", test_workqueue},
+    {"switch-bench", test_switch_bench},
+    {"timeout-expire", test_timeout_expire},
+    {"timeout-race", test_timeout_race},
+    {"timeout-donate", test_timeout_donate},
+    {"rwlock", test_rwlock},
+    {"timer-usleep", test_timer_usleep},
   };
 
 static const char *test_name;
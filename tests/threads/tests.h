@@ -32,6 +32,20 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_edf_admit;
+extern test_func test_edf_budget;
+extern test_func test_edf_deadline;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_nice_3;
+extern test_func test_cfs_sleeper;
+extern test_func test_cfs_mlfqs;
+extern test_func test_workqueue;
+extern test_func test_switch_bench;
+extern test_func test_timeout_expire;
+extern test_func test_timeout_race;
+extern test_func test_timeout_donate;
+extern test_func test_rwlock;
+extern test_func test_timer_usleep;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
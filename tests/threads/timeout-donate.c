@@ -0,0 +1,68 @@
+/* The main thread acquires a lock.  A medium-priority thread
+   then blocks acquiring the lock and a high-priority thread
+   waits for it with lock_acquire_timeout(), both donating their
+   priorities to the main thread.  When the high-priority
+   thread's timeout expires, its donation must be withdrawn, so
+   that the main thread drops back to the medium priority, and
+   after the main thread releases the lock, to its own. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func medium_thread_func;
+static thread_func high_thread_func;
+
+void
+test_timeout_donate (void) 
+{
+  struct lock lock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  lock_acquire (&lock);
+  thread_create ("medium", PRI_DEFAULT + 5, medium_thread_func, &lock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  thread_create ("high", PRI_DEFAULT + 10, high_thread_func, &lock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+  timer_sleep (20);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  lock_release (&lock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+medium_thread_func (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  msg ("medium: got the lock");
+  lock_release (lock);
+}
+
+static void
+high_thread_func (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  if (lock_acquire_timeout (lock, 10))
+    {
+      msg ("high: got the lock");
+      lock_release (lock);
+    }
+  else
+    msg ("high: timed out");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-donate) begin
+(timeout-donate) This thread should have priority 36.  Actual priority: 36.
+(timeout-donate) This thread should have priority 41.  Actual priority: 41.
+(timeout-donate) high: timed out
+(timeout-donate) This thread should have priority 36.  Actual priority: 36.
+(timeout-donate) medium: got the lock
+(timeout-donate) This thread should have priority 31.  Actual priority: 31.
+(timeout-donate) end
+EOF
+pass;
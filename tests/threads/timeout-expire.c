@@ -0,0 +1,83 @@
+/* Checks that sema_down_timeout(), lock_acquire_timeout() and
+   cond_wait_timeout() give up once their timeout expires, no
+   sooner, and leave nothing behind: the semaphore's next "up"
+   is not consumed by the waiter that gave up, a lock that timed
+   out can still be taken, and cond_wait_timeout() returns with
+   the lock held again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func lock_thread;
+static void check_elapsed (const char *what, int64_t start, int64_t ticks);
+
+void
+test_timeout_expire (void) 
+{
+  struct semaphore sema;
+  struct condition cond;
+  struct lock lock;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&sema, 0);
+  msg ("sema_down_timeout with 0 ticks: %s",
+       sema_down_timeout (&sema, 0) ? "decremented" : "timed out");
+  start = timer_ticks ();
+  msg ("sema_down_timeout with 10 ticks: %s",
+       sema_down_timeout (&sema, 10) ? "decremented" : "timed out");
+  check_elapsed ("sema_down_timeout", start, 10);
+  sema_up (&sema);
+  msg ("sema_up after the timeout %s the semaphore.",
+       sema_try_down (&sema) ? "upped" : "did not up");
+
+  lock_init (&lock);
+  lock_acquire (&lock);
+  thread_create ("lock", PRI_DEFAULT, lock_thread, &lock);
+  timer_sleep (20);
+  lock_release (&lock);
+  msg ("Main thread released the lock.");
+  timer_sleep (20);
+
+  cond_init (&cond);
+  lock_acquire (&lock);
+  start = timer_ticks ();
+  msg ("cond_wait_timeout with 10 ticks: %s",
+       cond_wait_timeout (&cond, &lock, 10) ? "signaled" : "timed out");
+  check_elapsed ("cond_wait_timeout", start, 10);
+  msg ("Lock %s after cond_wait_timeout.",
+       lock_held_by_current_thread (&lock) ? "held" : "not held");
+  cond_signal (&cond, &lock);
+  lock_release (&lock);
+}
+
+static void
+lock_thread (void *lock_) 
+{
+  struct lock *lock = lock_;
+  int64_t start = timer_ticks ();
+
+  msg ("lock_acquire_timeout with 10 ticks: %s",
+       lock_acquire_timeout (lock, 10) ? "acquired" : "timed out");
+  check_elapsed ("lock_acquire_timeout", start, 10);
+  msg ("lock_acquire_timeout with 30 ticks: %s",
+       lock_acquire_timeout (lock, 30) ? "acquired" : "timed out");
+  lock_release (lock);
+}
+
+/* Fails unless at least TICKS ticks have passed since START. */
+static void
+check_elapsed (const char *what, int64_t start, int64_t ticks) 
+{
+  int64_t elapsed = timer_elapsed (start);
+
+  if (elapsed < ticks)
+    fail ("%s gave up after %lld ticks, expected at least %lld.",
+          what, (long long) elapsed, (long long) ticks);
+}
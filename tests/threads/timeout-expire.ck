@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-expire) begin
+(timeout-expire) sema_down_timeout with 0 ticks: timed out
+(timeout-expire) sema_down_timeout with 10 ticks: timed out
+(timeout-expire) sema_up after the timeout upped the semaphore.
+(timeout-expire) lock_acquire_timeout with 10 ticks: timed out
+(timeout-expire) Main thread released the lock.
+(timeout-expire) lock_acquire_timeout with 30 ticks: acquired
+(timeout-expire) cond_wait_timeout with 10 ticks: timed out
+(timeout-expire) Lock held after cond_wait_timeout.
+(timeout-expire) end
+EOF
+pass;
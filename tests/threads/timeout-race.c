@@ -0,0 +1,78 @@
+/* Races a sema_up() against the expiry of a sema_down_timeout()
+   on the same semaphore.  Whichever wins, the "up" must not be
+   lost: if the waiter reports that it timed out, the semaphore
+   must still hold the "up", and if it reports that it
+   decremented the semaphore, the semaphore must be back at 0.
+   An "up" well before or well after the deadline must be seen
+   or missed, respectively. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of rounds with the "up" due at the very deadline. */
+#define RACE_ROUNDS 10
+
+struct race
+  {
+    struct semaphore sema;      /* Semaphore raced on. */
+    struct semaphore done;      /* Upped once the helper is done. */
+    int64_t delay;              /* Ticks before the helper ups. */
+  };
+
+static thread_func up_thread;
+static bool race (int64_t delay);
+
+void
+test_timeout_race (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Early sema_up: %s.", race (5) ? "decremented" : "timed out");
+  msg ("Late sema_up: %s.", race (15) ? "decremented" : "timed out");
+  for (i = 0; i < RACE_ROUNDS; i++)
+    race (10);
+  msg ("%d racing sema_ups, none lost.", RACE_ROUNDS);
+}
+
+/* Runs one round: waits 10 ticks for a semaphore that a helper
+   ups after DELAY ticks, checks that the "up" was not lost, and
+   returns whether the wait decremented the semaphore. */
+static bool
+race (int64_t delay) 
+{
+  struct race r;
+  bool decremented;
+
+  sema_init (&r.sema, 0);
+  sema_init (&r.done, 0);
+  r.delay = delay;
+
+  /* The helper runs first, so its delay starts no later than our
+     timeout. */
+  thread_create ("up", PRI_DEFAULT + 1, up_thread, &r);
+  decremented = sema_down_timeout (&r.sema, 10);
+  sema_down (&r.done);
+
+  if (sema_try_down (&r.sema) == decremented)
+    fail ("sema_down_timeout %s, but the semaphore %s the \"up\".",
+          decremented ? "decremented the semaphore" : "timed out",
+          decremented ? "still holds" : "lost");
+  return decremented;
+}
+
+static void
+up_thread (void *r_) 
+{
+  struct race *r = r_;
+
+  timer_sleep (r->delay);
+  sema_up (&r->sema);
+  sema_up (&r->done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-race) begin
+(timeout-race) Early sema_up: decremented.
+(timeout-race) Late sema_up: timed out.
+(timeout-race) 10 racing sema_ups, none lost.
+(timeout-race) end
+EOF
+pass;
@@ -0,0 +1,74 @@
+/* Checks the clock and the sleeps shorter than a tick that run
+   off the time-stamp counter.  timer_ns() must never go
+   backward.  timer_usleep(500), half a tick, must block rather
+   than spin: a lower-priority thread that only gets the CPU while
+   the main thread is blocked must make progress during each
+   sleep.  Each sleep must also last at least 500 microseconds. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READ_CNT 100000
+#define SLEEP_CNT 10
+#define SLEEP_US 500
+
+/* Incremented by counter_thread() while it runs. */
+static volatile unsigned long long counter;
+
+/* Set to make counter_thread() exit. */
+static volatile bool done;
+
+static thread_func counter_thread;
+
+void
+test_timer_usleep (void) 
+{
+  uint64_t prev, now;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  prev = timer_ns ();
+  for (i = 0; i < READ_CNT; i++)
+    {
+      now = timer_ns ();
+      if (now < prev)
+        fail ("timer_ns() went backward from %llu to %llu.",
+              (unsigned long long) prev, (unsigned long long) now);
+      prev = now;
+    }
+  msg ("timer_ns() never went backward.");
+
+  done = false;
+  thread_create ("counter", PRI_DEFAULT - 1, counter_thread, NULL);
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      unsigned long long count = counter;
+      uint64_t start = timer_ns ();
+      uint64_t slept;
+
+      timer_usleep (SLEEP_US);
+      slept = timer_ns () - start;
+      if (slept < SLEEP_US * 1000)
+        fail ("timer_usleep(%d) returned after only %llu ns.",
+              SLEEP_US, (unsigned long long) slept);
+      if (counter == count)
+        fail ("timer_usleep(%d) did not let a lower-priority thread run.",
+              SLEEP_US);
+    }
+  done = true;
+  msg ("timer_usleep(%d) blocked for long enough %d times.",
+       SLEEP_US, SLEEP_CNT);
+}
+
+static void
+counter_thread (void *aux UNUSED) 
+{
+  while (!done)
+    counter++;
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-usleep) begin
+(timer-usleep) timer_ns() never went backward.
+(timer-usleep) timer_usleep(500) blocked for long enough 10 times.
+(timer-usleep) end
+EOF
+pass;
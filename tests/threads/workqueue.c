@@ -0,0 +1,151 @@
+/* Tests the workqueue: items run in FIFO order, a pending item
+   cannot be queued twice, not even while it waits in a worker's
+   batch, an item may queue itself again,
+   delayed items run no earlier than they are due, cancelled
+   items never run, and workqueue_flush() waits for pending work
+   but not for delayed work that is not yet due.
+
+   The worker runs below the main thread's priority, so work only
+   runs while the main thread is blocked. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+static struct workqueue wq;
+static work_func say_work, requeue_work, timed_work;
+static work_func requeue_next_work, cancel_next_work;
+
+/* Number of runs left for requeue_work(). */
+static int requeue_cnt;
+
+/* Tick at which timed_work() last ran, or -1. */
+static int64_t timed_ran;
+
+void
+test_workqueue (void)
+{
+  struct work a, b, c, d, e, f, g, h, again, timed;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  workqueue_init (&wq, "wq-test", PRI_DEFAULT - 1, 1, 2);
+
+  /* FIFO order, and no double queueing. */
+  work_init (&a, say_work, "a");
+  work_init (&b, say_work, "b");
+  work_init (&c, say_work, "c");
+  workqueue_queue (&wq, &a);
+  workqueue_queue (&wq, &b);
+  workqueue_queue (&wq, &c);
+  msg ("Queueing a again: %s",
+       workqueue_queue (&wq, &a) ? "queued" : "already pending");
+  msg ("Flushing.");
+  workqueue_flush (&wq);
+  msg ("Flushed.");
+
+  /* Cancelling pending work. */
+  work_init (&d, say_work, "d");
+  workqueue_queue (&wq, &d);
+  msg ("Cancelling d: %s", workqueue_cancel (&d) ? "cancelled" : "missed");
+  msg ("Cancelling d again: %s",
+       workqueue_cancel (&d) ? "cancelled" : "missed");
+  workqueue_flush (&wq);
+  msg ("Flushed.");
+
+  /* Queueing and cancelling the second item of a batch from the
+     first, while the worker has claimed both. */
+  work_init (&f, say_work, "f");
+  work_init (&e, requeue_next_work, &f);
+  workqueue_queue (&wq, &e);
+  workqueue_queue (&wq, &f);
+  workqueue_flush (&wq);
+  msg ("Flushed.");
+
+  work_init (&h, say_work, "h");
+  work_init (&g, cancel_next_work, &h);
+  workqueue_queue (&wq, &g);
+  workqueue_queue (&wq, &h);
+  workqueue_flush (&wq);
+  msg ("Queueing h after flush: %s",
+       workqueue_queue (&wq, &h) ? "queued" : "already pending");
+  workqueue_flush (&wq);
+  msg ("Flushed.");
+
+  /* Work that queues itself again. */
+  requeue_cnt = 3;
+  work_init (&again, requeue_work, NULL);
+  workqueue_queue (&wq, &again);
+  workqueue_flush (&wq);
+  msg ("Flushed with %d runs left.", requeue_cnt);
+
+  /* Delayed work, cancelled before it is due. */
+  timed_ran = -1;
+  work_init (&timed, timed_work, NULL);
+  workqueue_queue_delayed (&wq, &timed, 5);
+  msg ("Cancelling delayed work: %s",
+       workqueue_cancel (&timed) ? "cancelled" : "missed");
+  timer_sleep (10);
+  workqueue_flush (&wq);
+  msg ("Delayed work %s.", timed_ran < 0 ? "did not run" : "ran");
+
+  /* Delayed work that runs. */
+  start = timer_ticks ();
+  workqueue_queue_delayed (&wq, &timed, 10);
+  workqueue_flush (&wq);
+  msg ("Flushed before delayed work was due: %s.",
+       timed_ran < 0 ? "ok" : "FAILED");
+  timer_sleep (20);
+  workqueue_flush (&wq);
+  if (timed_ran < 0)
+    fail ("Delayed work did not run.");
+  else if (timed_ran - start < 10)
+    fail ("Delayed work ran after %lld ticks, expected at least 10.",
+          (long long) (timed_ran - start));
+  else
+    msg ("Delayed work ran when due.");
+}
+
+static void
+say_work (struct work *w)
+{
+  msg ("Work %s ran.", (const char *) w->aux);
+}
+
+static void
+requeue_work (struct work *w)
+{
+  msg ("Requeueing work ran.");
+  if (--requeue_cnt > 0)
+    workqueue_queue (&wq, w);
+}
+
+/* Tries to queue the work item in W's aux, which is in the same
+   batch as W. */
+static void
+requeue_next_work (struct work *w)
+{
+  msg ("Queueing f from e: %s",
+       workqueue_queue (&wq, w->aux) ? "queued" : "already pending");
+}
+
+/* Cancels the work item in W's aux, which is in the same batch
+   as W. */
+static void
+cancel_next_work (struct work *w)
+{
+  msg ("Cancelling h from g: %s",
+       workqueue_cancel (w->aux) ? "cancelled" : "missed");
+}
+
+static void
+timed_work (struct work *w UNUSED)
+{
+  timed_ran = timer_ticks ();
+}
@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Queueing a again: already pending
+(workqueue) Flushing.
+(workqueue) Work a ran.
+(workqueue) Work b ran.
+(workqueue) Work c ran.
+(workqueue) Flushed.
+(workqueue) Cancelling d: cancelled
+(workqueue) Cancelling d again: missed
+(workqueue) Flushed.
+(workqueue) Queueing f from e: already pending
+(workqueue) Work f ran.
+(workqueue) Flushed.
+(workqueue) Cancelling h from g: cancelled
+(workqueue) Queueing h after flush: queued
+(workqueue) Work h ran.
+(workqueue) Flushed.
+(workqueue) Requeueing work ran.
+(workqueue) Requeueing work ran.
+(workqueue) Requeueing work ran.
+(workqueue) Flushed with 0 runs left.
+(workqueue) Cancelling delayed work: cancelled
+(workqueue) Delayed work did not run.
+(workqueue) Flushed before delayed work was due: ok.
+(workqueue) Delayed work ran when due.
+(workqueue) end
+EOF
+pass;
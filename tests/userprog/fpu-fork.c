@@ -0,0 +1,151 @@
+/* Loads distinct values into the SSE and x87 registers, then
+   forks.  The child must start with the parent's values.  Each
+   process then loads values of its own and checks them over and
+   over while the two preempt each other for several time slices,
+   so that each one's FPU state is saved and restored many times.
+
+   User programs are compiled without SSE or x87 code, so nothing
+   but the inline assembly here touches those registers. */
+
+#include <sched-stats.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Time slices each process must lose to the other. */
+#define SWITCHES 5
+
+/* Contents of XMM0...XMM7, then of the two x87 stack slots,
+   bottom first. */
+#define FPU_WORDS 18
+
+/* Fills REGS with values derived from SEED. */
+static void
+fpu_values (uint64_t regs[FPU_WORDS], uint64_t seed)
+{
+  int i;
+
+  for (i = 0; i < FPU_WORDS; i++)
+    regs[i] = seed * (i + 1) + i;
+}
+
+/* Loads REGS into the FPU registers. */
+static void
+fpu_load (const uint64_t regs[FPU_WORDS])
+{
+  asm volatile ("movdqu 0(%0), %%xmm0\n\t"
+                "movdqu 16(%0), %%xmm1\n\t"
+                "movdqu 32(%0), %%xmm2\n\t"
+                "movdqu 48(%0), %%xmm3\n\t"
+                "movdqu 64(%0), %%xmm4\n\t"
+                "movdqu 80(%0), %%xmm5\n\t"
+                "movdqu 96(%0), %%xmm6\n\t"
+                "movdqu 112(%0), %%xmm7\n\t"
+                "fninit\n\t"
+                "fildq 128(%0)\n\t"
+                "fildq 136(%0)"
+                : : "r" (regs) : "memory");
+}
+
+/* Stores the FPU registers into REGS, leaving them unchanged. */
+static void
+fpu_store (uint64_t regs[FPU_WORDS])
+{
+  asm volatile ("movdqu %%xmm0, 0(%0)\n\t"
+                "movdqu %%xmm1, 16(%0)\n\t"
+                "movdqu %%xmm2, 32(%0)\n\t"
+                "movdqu %%xmm3, 48(%0)\n\t"
+                "movdqu %%xmm4, 64(%0)\n\t"
+                "movdqu %%xmm5, 80(%0)\n\t"
+                "movdqu %%xmm6, 96(%0)\n\t"
+                "movdqu %%xmm7, 112(%0)\n\t"
+                "fistpq 136(%0)\n\t"
+                "fistpq 128(%0)\n\t"
+                "fildq 128(%0)\n\t"
+                "fildq 136(%0)"
+                : : "r" (regs) : "memory");
+}
+
+/* Fails unless the FPU registers hold the values for SEED. */
+static void
+fpu_check (uint64_t seed, const char *when)
+{
+  uint64_t expected[FPU_WORDS], actual[FPU_WORDS];
+  int i;
+
+  fpu_store (actual);
+  fpu_values (expected, seed);
+  for (i = 0; i < FPU_WORDS; i++)
+    if (actual[i] != expected[i])
+      fail ("%s: FPU word %d is %llx, expected %llx", when, i,
+            (unsigned long long) actual[i],
+            (unsigned long long) expected[i]);
+}
+
+/* Returns the involuntary switch count of process PID, or -1 if
+   it has exited. */
+static long long
+switch_cnt (pid_t pid)
+{
+  struct sched_stats s;
+
+  return sched_stats (pid, &s) ? (long long) s.involuntary_switches : -1;
+}
+
+/* Checks the values for SEED until process PID has been
+   preempted TARGET times in all, or has exited. */
+static void
+fpu_spin (uint64_t seed, pid_t pid, long long target, const char *when)
+{
+  long long cnt;
+
+  do
+    {
+      volatile int delay;
+
+      fpu_check (seed, when);
+      for (delay = 0; delay < 10000; delay++)
+        continue;
+      cnt = switch_cnt (pid);
+    }
+  while (cnt >= 0 && cnt < target);
+}
+
+void
+test_main (void) 
+{
+  uint64_t regs[FPU_WORDS];
+  uint64_t parent_seed = 0x0123456789abcdefULL;
+  uint64_t child_seed = 0x0fedcba987654321ULL;
+  pid_t pid;
+
+  fpu_values (regs, parent_seed);
+  fpu_load (regs);
+
+  pid = fork ("fpu-child");
+  if (pid == 0)
+    {
+      fpu_check (parent_seed, "child after fork");
+      msg ("child: inherited the parent's FPU state");
+
+      fpu_values (regs, child_seed);
+      fpu_load (regs);
+      fpu_spin (child_seed, 0, switch_cnt (0) + SWITCHES, "child");
+      msg ("child: FPU state survived preemption");
+      exit (0);
+    }
+
+  if (pid < 0)
+    fail ("fork failed");
+  fpu_check (parent_seed, "parent after fork");
+
+  /* The child exits only after it has been preempted at least
+     SWITCHES times, each time in favour of this process or
+     another, so this loop ends no later than the child does. */
+  fpu_spin (parent_seed, pid, SWITCHES, "parent");
+  if (wait (pid) != 0)
+    fail ("child failed");
+  fpu_check (parent_seed, "parent after wait");
+  msg ("parent: FPU state survived preemption");
+}
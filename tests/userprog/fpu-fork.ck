@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-fork) begin
+(fpu-fork) child: inherited the parent's FPU state
+(fpu-fork) child: FPU state survived preemption
+fpu-child: exit(0)
+(fpu-fork) parent: FPU state survived preemption
+(fpu-fork) end
+fpu-fork: exit(0)
+EOF
+pass;
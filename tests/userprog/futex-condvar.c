@@ -0,0 +1,76 @@
+/* Tests the user condition variable.  Waiters announce
+   themselves on one condition variable and then wait on another
+   for a flag.  The main thread sets the flag and broadcasts
+   while holding the mutex, which moves the waiters to the mutex
+   with FUTEX_REQUEUE, then once more signals the waiters one at
+   a time. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct condvar ready_cv = CONDVAR_INITIALIZER;
+static struct condvar go_cv = CONDVAR_INITIALIZER;
+static int ready_cnt;           /* # of threads waiting for `go'. */
+static int go;                  /* Round the waiters may start. */
+static int done_cnt;            /* # of threads past their round. */
+
+static void
+waiter (void *aux UNUSED) 
+{
+  int round;
+
+  mutex_lock (&mutex);
+  for (round = 1; round <= 2; round++)
+    {
+      ready_cnt++;
+      condvar_signal (&ready_cv);
+      while (go < round)
+        condvar_wait (&go_cv, &mutex);
+      done_cnt++;
+    }
+  mutex_unlock (&mutex);
+}
+
+/* Waits until all the waiters wait for round ROUND. */
+static void
+wait_ready (int round) 
+{
+  while (ready_cnt < THREAD_CNT * round)
+    condvar_wait (&ready_cv, &mutex);
+}
+
+void
+test_main (void) 
+{
+  pid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (waiter, NULL)) != -1,
+           "thread_create %d", i);
+
+  mutex_lock (&mutex);
+  wait_ready (1);
+  msg ("broadcast");
+  go = 1;
+  condvar_broadcast (&go_cv);
+  wait_ready (2);
+  if (done_cnt != THREAD_CNT)
+    fail ("%d threads woke from the broadcast, expected %d",
+          done_cnt, THREAD_CNT);
+
+  msg ("signal each");
+  go = 2;
+  for (i = 0; i < THREAD_CNT; i++)
+    condvar_signal (&go_cv);
+  mutex_unlock (&mutex);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == 0, "thread_join %d", i);
+  CHECK (done_cnt == 2 * THREAD_CNT, "all threads woke twice");
+}
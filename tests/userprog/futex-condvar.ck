@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-condvar) begin
+(futex-condvar) thread_create 0
+(futex-condvar) thread_create 1
+(futex-condvar) thread_create 2
+(futex-condvar) thread_create 3
+(futex-condvar) broadcast
+(futex-condvar) signal each
+(futex-condvar) thread_join 0
+(futex-condvar) thread_join 1
+(futex-condvar) thread_join 2
+(futex-condvar) thread_join 3
+(futex-condvar) all threads woke twice
+(futex-condvar) end
+futex-condvar: exit(0)
+EOF
+pass;
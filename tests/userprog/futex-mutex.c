@@ -0,0 +1,51 @@
+/* Several threads increment a shared counter under a user mutex,
+   with a delay between reading the counter and writing it back,
+   so that the threads are preempted while holding the mutex and
+   the others contend for it.  No increment may be lost. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 2000
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static int counter;
+
+static void
+incrementer (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      volatile int delay;
+      int value;
+
+      mutex_lock (&mutex);
+      value = counter;
+      for (delay = 0; delay < 1000; delay++)
+        continue;
+      counter = value + 1;
+      mutex_unlock (&mutex);
+    }
+}
+
+void
+test_main (void) 
+{
+  pid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (incrementer, NULL)) != -1,
+           "thread_create %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == 0, "thread_join %d", i);
+  CHECK (counter == THREAD_CNT * ITERATIONS, "counter is %d",
+         THREAD_CNT * ITERATIONS);
+  CHECK (mutex_trylock (&mutex), "mutex is free");
+  mutex_unlock (&mutex);
+}
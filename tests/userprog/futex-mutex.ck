@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-mutex) begin
+(futex-mutex) thread_create 0
+(futex-mutex) thread_create 1
+(futex-mutex) thread_create 2
+(futex-mutex) thread_create 3
+(futex-mutex) thread_join 0
+(futex-mutex) thread_join 1
+(futex-mutex) thread_join 2
+(futex-mutex) thread_join 3
+(futex-mutex) counter is 8000
+(futex-mutex) mutex is free
+(futex-mutex) end
+futex-mutex: exit(0)
+EOF
+pass;
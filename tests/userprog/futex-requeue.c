@@ -0,0 +1,63 @@
+/* Tests FUTEX_REQUEUE.  Three threads wait on one futex.  A
+   requeue that wakes none of them moves them all to a second
+   futex, where they keep sleeping.  A requeue from there wakes
+   one and moves the other two to a third futex, from which
+   FUTEX_WAKE wakes them. */
+
+#include <limits.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define WAITER_CNT 3
+
+static int a, b, c;
+static int wait_results[WAITER_CNT];
+
+static void
+waiter (void *result_) 
+{
+  int *result = result_;
+
+  *result = futex (&a, FUTEX_WAIT, 0, NULL, 0);
+}
+
+void
+test_main (void) 
+{
+  pid_t tids[WAITER_CNT];
+  int moved;
+  int i;
+
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      wait_results[i] = 1;
+      tids[i] = thread_create (waiter, &wait_results[i]);
+      if (tids[i] == -1)
+        fail ("thread_create");
+    }
+
+  /* Move the waiters as they fall asleep. */
+  moved = 0;
+  while (moved < WAITER_CNT)
+    moved += futex (&a, FUTEX_REQUEUE, 0, &b, INT_MAX);
+  CHECK (moved == WAITER_CNT, "requeued %d waiters without waking them",
+         WAITER_CNT);
+  CHECK (futex (&a, FUTEX_WAKE, INT_MAX, NULL, 0) == 0,
+         "no waiters left on the first futex");
+
+  CHECK (futex (&b, FUTEX_REQUEUE, 1, &c, INT_MAX) == WAITER_CNT,
+         "woke 1 waiter and requeued the other %d", WAITER_CNT - 1);
+  CHECK (futex (&c, FUTEX_WAKE, INT_MAX, NULL, 0) == WAITER_CNT - 1,
+         "woke the %d requeued waiters", WAITER_CNT - 1);
+
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      quiet = true;
+      CHECK (thread_join (tids[i]) == 0, "thread_join %d", i);
+      quiet = false;
+      if (wait_results[i] != 0)
+        fail ("waiter %d: FUTEX_WAIT returned %d", i, wait_results[i]);
+    }
+  msg ("all waiters returned 0");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-requeue) begin
+(futex-requeue) requeued 3 waiters without waking them
+(futex-requeue) no waiters left on the first futex
+(futex-requeue) woke 1 waiter and requeued the other 2
+(futex-requeue) woke the 2 requeued waiters
+(futex-requeue) all waiters returned 0
+(futex-requeue) end
+futex-requeue: exit(0)
+EOF
+pass;
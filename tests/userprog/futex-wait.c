@@ -0,0 +1,41 @@
+/* Tests FUTEX_WAIT and FUTEX_WAKE: waiting on a value that has
+   already changed returns -1 at once, waking a futex without
+   waiters wakes nobody, and a thread asleep in FUTEX_WAIT
+   returns 0 once woken. */
+
+#include <limits.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int word;
+static int wait_result = 1;
+
+static void
+waiter (void *aux UNUSED) 
+{
+  wait_result = futex (&word, FUTEX_WAIT, 0, NULL, 0);
+}
+
+void
+test_main (void) 
+{
+  pid_t tid;
+  int woken;
+
+  word = 1;
+  CHECK (futex (&word, FUTEX_WAIT, 0, NULL, 0) == -1,
+         "FUTEX_WAIT on a changed value returns -1");
+  CHECK (futex (&word, FUTEX_WAKE, INT_MAX, NULL, 0) == 0,
+         "FUTEX_WAKE without waiters wakes nobody");
+
+  word = 0;
+  CHECK ((tid = thread_create (waiter, NULL)) != -1, "thread_create");
+
+  /* Keep trying until the waiter is asleep. */
+  while ((woken = futex (&word, FUTEX_WAKE, INT_MAX, NULL, 0)) == 0)
+    continue;
+  CHECK (woken == 1, "FUTEX_WAKE woke one waiter");
+  CHECK (thread_join (tid) == 0, "thread_join");
+  CHECK (wait_result == 0, "FUTEX_WAIT returned 0 after the wakeup");
+}
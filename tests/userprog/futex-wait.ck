@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-wait) begin
+(futex-wait) FUTEX_WAIT on a changed value returns -1
+(futex-wait) FUTEX_WAKE without waiters wakes nobody
+(futex-wait) thread_create
+(futex-wait) FUTEX_WAKE woke one waiter
+(futex-wait) thread_join
+(futex-wait) FUTEX_WAIT returned 0 after the wakeup
+(futex-wait) end
+futex-wait: exit(0)
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Reads the process's scheduler statistics before and after it
+   blocks in fork() and wait().  The voluntary switch count must
+   rise, and every one of those switches must be matched by
+   exactly one wakeup in the latency histogram, since the process
+   has run again after each.  Then asks for the statistics of
+   processes that do not exist, and finally passes a bad buffer,
+   which must kill the process. */
+
+#include <sched-stats.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Returns the number of wakeups recorded in S. */
+static uint64_t
+wakeup_cnt (const struct sched_stats *s)
+{
+  uint64_t cnt = 0;
+  int i;
+
+  for (i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+    cnt += s->latency[i];
+  return cnt;
+}
+
+void
+test_main (void) 
+{
+  struct sched_stats before, after;
+  pid_t pid;
+  int status;
+
+  CHECK (sched_stats (0, &before), "sched_stats (0)");
+
+  /* The child spins so that it is still running when the parent
+     gets to wait(), which then has to block. */
+  pid = fork ("sched-stats-child");
+  if (pid == 0)
+    {
+      volatile int i;
+
+      for (i = 0; i < 1000000; i++)
+        continue;
+      exit (0);
+    }
+  status = wait (pid);
+  CHECK (status == 0, "wait (fork ())");
+
+  CHECK (sched_stats (0, &after), "sched_stats (0) again");
+  CHECK (after.voluntary_switches > before.voluntary_switches,
+         "voluntary switches rose");
+  CHECK (wakeup_cnt (&after) - wakeup_cnt (&before)
+         == after.voluntary_switches - before.voluntary_switches,
+         "one wakeup per voluntary switch");
+  CHECK (after.run_time > before.run_time, "run time rose");
+
+  CHECK (!sched_stats (1 << 30, &after), "sched_stats (unused pid) fails");
+  CHECK (!sched_stats (-1, &after), "sched_stats (-1) fails");
+
+  msg ("sched_stats (0, NULL)");
+  sched_stats (0, NULL);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(sched-stats) begin
+(sched-stats) sched_stats (0)
+sched-stats-child: exit(0)
+(sched-stats) wait (fork ())
+(sched-stats) sched_stats (0) again
+(sched-stats) voluntary switches rose
+(sched-stats) one wakeup per voluntary switch
+(sched-stats) run time rose
+(sched-stats) sched_stats (unused pid) fails
+(sched-stats) sched_stats (-1) fails
+(sched-stats) sched_stats (0, NULL)
+sched-stats: exit(-1)
+EOF
+
+# The kernel dumps its scheduler statistics when it shuts down.
+our ($test);
+my (@output) = read_text_file ("$test.output");
+fail "No scheduler totals at shutdown.\n"
+  if !grep (/^Scheduler: \d+ cycles running, \d+ cycles waiting, \d+ voluntary, \d+ involuntary switches$/, @output);
+fail "No wakeup latency histogram at shutdown.\n"
+  if !grep (/^Scheduler: \d+ wakeups ran after 2\^\d+ cycles$/, @output);
+pass;
@@ -0,0 +1,71 @@
+/* Starts several threads in one process and joins them.  The
+   threads share the process's memory and file descriptors.  A
+   thread can be joined only once, and joining a tid that is not
+   a thread of the process fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+
+struct job
+  {
+    int in;                     /* Input. */
+    int out;                    /* Output, the square of IN. */
+  };
+
+static struct job jobs[THREAD_CNT];
+static int handle;
+static char buf[sizeof sample];
+
+static void
+square (void *job_) 
+{
+  struct job *job = job_;
+
+  job->out = job->in * job->in;
+}
+
+static void
+reader (void *aux UNUSED) 
+{
+  read (handle, buf, sizeof sample - 1);
+}
+
+void
+test_main (void) 
+{
+  pid_t tids[THREAD_CNT];
+  pid_t tid;
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      jobs[i].in = i + 2;
+      CHECK ((tids[i] = thread_create (square, &jobs[i])) != -1,
+             "thread_create %d", i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      CHECK (thread_join (tids[i]) == 0, "thread_join %d", i);
+      if (jobs[i].out != jobs[i].in * jobs[i].in)
+        fail ("thread %d computed %d, expected %d",
+              i, jobs[i].out, jobs[i].in * jobs[i].in);
+    }
+  msg ("all threads computed their results");
+
+  CHECK (thread_join (tids[0]) == -1, "joining thread 0 again fails");
+  CHECK (thread_join (12345) == -1, "joining a bogus tid fails");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((tid = thread_create (reader, NULL)) != -1, "thread_create reader");
+  CHECK (thread_join (tid) == 0, "thread_join reader");
+  CHECK (tell (handle) == sizeof sample - 1,
+         "reader moved the shared file position");
+  if (memcmp (buf, sample, sizeof sample - 1))
+    fail ("reader read the wrong data");
+  close (handle);
+}
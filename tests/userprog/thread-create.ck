@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-create) begin
+(thread-create) thread_create 0
+(thread-create) thread_create 1
+(thread-create) thread_create 2
+(thread-create) thread_create 3
+(thread-create) thread_join 0
+(thread-create) thread_join 1
+(thread-create) thread_join 2
+(thread-create) thread_join 3
+(thread-create) all threads computed their results
+(thread-create) joining thread 0 again fails
+(thread-create) joining a bogus tid fails
+(thread-create) open "sample.txt"
+(thread-create) thread_create reader
+(thread-create) thread_join reader
+(thread-create) reader moved the shared file position
+(thread-create) end
+thread-create: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* A thread other than the leader calls exit(), which ends the
+   whole process with its status.  The leader meanwhile sleeps in
+   FUTEX_WAIT on a value that nobody changes, so it only wakes
+   because the process is exiting.  The parent checks the status
+   with wait(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int never;
+
+static void
+exiter (void *aux UNUSED) 
+{
+  msg ("exiting from a thread");
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  if ((pid = fork ("thread-exit-child")) == 0)
+    {
+      if (thread_create (exiter, NULL) == -1)
+        fail ("thread_create");
+      for (;;)
+        futex (&never, FUTEX_WAIT, 0, NULL, 0);
+    }
+  msg ("wait(fork()) = %d", wait (pid));
+}
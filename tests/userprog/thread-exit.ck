@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit) begin
+(thread-exit) exiting from a thread
+thread-exit-child: exit(57)
+(thread-exit) wait(fork()) = 57
+(thread-exit) end
+thread-exit: exit(0)
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* A thread other than the leader dereferences a null pointer.
+   The kernel kills the whole process with status -1, including
+   the leader, which is blocked in thread_join() on that thread
+   and must not get back to user code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+faulter (void *aux UNUSED) 
+{
+  msg ("Congratulations - you have successfully dereferenced NULL: %d",
+       *(volatile int *) NULL);
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  if ((pid = fork ("thread-kill-child")) == 0)
+    {
+      pid_t tid = thread_create (faulter, NULL);
+
+      if (tid == -1)
+        fail ("thread_create");
+      thread_join (tid);
+      fail ("leader survived the fault");
+    }
+  msg ("wait(fork()) = %d", wait (pid));
+}
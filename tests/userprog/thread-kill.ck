@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(thread-kill) begin
+thread-kill-child: exit(-1)
+(thread-kill) wait(fork()) = -1
+(thread-kill) end
+thread-kill: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* The leader of a process calls thread_exit() while another
+   thread of the process still runs.  The process lives on until
+   that thread is done too, and then exits with status 0. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int leader_gone;
+
+static void
+worker (void *aux UNUSED) 
+{
+  while (!leader_gone)
+    futex (&leader_gone, FUTEX_WAIT, 0, NULL, 0);
+  msg ("worker done");
+}
+
+void
+test_main (void) 
+{
+  CHECK (thread_create (worker, NULL) != -1, "thread_create");
+  msg ("leader exiting");
+  leader_gone = 1;
+  futex (&leader_gone, FUTEX_WAKE, 1, NULL, 0);
+  thread_exit ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-leader-exit) begin
+(thread-leader-exit) thread_create
+(thread-leader-exit) leader exiting
+(thread-leader-exit) worker done
+thread-leader-exit: exit(0)
+EOF
+pass;
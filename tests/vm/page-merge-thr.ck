@@ -0,0 +1,38 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(page-merge-thr) begin
+(page-merge-thr) init
+(page-merge-thr) sort chunk 0
+(page-merge-thr) thread_create 0
+(page-merge-thr) sort chunk 1
+(page-merge-thr) thread_create 1
+(page-merge-thr) sort chunk 2
+(page-merge-thr) thread_create 2
+(page-merge-thr) sort chunk 3
+(page-merge-thr) thread_create 3
+(page-merge-thr) sort chunk 4
+(page-merge-thr) thread_create 4
+(page-merge-thr) sort chunk 5
+(page-merge-thr) thread_create 5
+(page-merge-thr) sort chunk 6
+(page-merge-thr) thread_create 6
+(page-merge-thr) sort chunk 7
+(page-merge-thr) thread_create 7
+(page-merge-thr) join thread 0
+(page-merge-thr) join thread 1
+(page-merge-thr) join thread 2
+(page-merge-thr) join thread 3
+(page-merge-thr) join thread 4
+(page-merge-thr) join thread 5
+(page-merge-thr) join thread 6
+(page-merge-thr) join thread 7
+(page-merge-thr) merge
+(page-merge-thr) verify
+(page-merge-thr) success, buf_idx=1,048,576
+(page-merge-thr) end
+page-merge-thr: exit(0)
+EOF
+pass;
@@ -82,6 +82,47 @@ sort_chunks (const char *subprocess, int exit_status)
     }
 }
 
+/* Histograms for sort_chunk(), one per chunk, kept out of the
+   threads' small stacks. */
+static size_t chunk_histograms[CHUNK_CNT][256];
+
+/* Thread function for sort_chunks_threaded().  Sorts chunk
+   CHUNK_ of buf1 in place with counting sort, like child-sort. */
+static void
+sort_chunk (void *chunk_)
+{
+  size_t chunk = (size_t) chunk_;
+  size_t *hist = chunk_histograms[chunk];
+  unsigned char *p = buf1 + CHUNK_SIZE * chunk;
+  size_t i;
+
+  for (i = 0; i < CHUNK_SIZE; i++)
+    hist[p[i]]++;
+  for (i = 0; i < 256; i++)
+    {
+      size_t j = hist[i];
+      while (j-- > 0)
+        *p++ = i;
+    }
+}
+
+/* Sort each chunk of buf1 in a thread of its own. */
+static void
+sort_chunks_threaded (void)
+{
+  pid_t threads[CHUNK_CNT];
+  size_t i;
+
+  for (i = 0; i < CHUNK_CNT; i++)
+    {
+      msg ("sort chunk %zu", i);
+      CHECK ((threads[i] = thread_create (sort_chunk, (void *) i)) != -1,
+             "thread_create %zu", i);
+    }
+  for (i = 0; i < CHUNK_CNT; i++)
+    CHECK (thread_join (threads[i]) == 0, "join thread %zu", i);
+}
+
 /* Merge the sorted chunks in buf1 into a fully sorted buf2. */
 static void
 merge (void)
@@ -149,3 +190,14 @@ parallel_merge (const char *child_name, int exit_status)
   merge ();
   verify ();
 }
+
+/* Like parallel_merge(), but sorts the chunks in threads of this
+   process instead of in subprocesses. */
+void
+parallel_merge_threads (void)
+{
+  init ();
+  sort_chunks_threaded ();
+  merge ();
+  verify ();
+}
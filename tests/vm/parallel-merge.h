@@ -2,5 +2,6 @@
 #define TESTS_VM_PARALLEL_MERGE 1
 
 void parallel_merge (const char *child_name, int exit_status);
+void parallel_merge_threads (void);
 
 #endif /* tests/vm/parallel-merge.h */
@@ -13,6 +13,7 @@
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -372,6 +373,13 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+#ifdef USERPROG
+	/* Threads of an exiting process die on their way back to
+	   user mode. */
+	if (frame->cs == SEL_UCSEG)
+		process_check_exit ();
+#endif
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
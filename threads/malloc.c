@@ -11,35 +11,62 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Classes are 16 bytes apart up to
+   128 bytes and about 12.5% apart above that, so rounding wastes
+   at most about an eighth of a block.  The descriptor keeps a
+   list of free blocks.  If the free list is nonempty, one of its
+   blocks is used to satisfy the request.
+
+   Otherwise, a new "arena" of one or more contiguous pages is
    obtained from the page allocator (if none is available,
    malloc() returns a null pointer).  The new arena is divided
    into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   list.  Then we return one of the new blocks.  Each class uses
+   the smallest arena, of 1 to MAX_ARENA_PAGES pages, that leaves
+   no more than an eighth of it unused, so that blocks of up to
+   about 8 kB pack several to an arena instead of each wasting
+   most of a page.
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   A block is mapped back to its arena through the owner that
+   the arena records for each of its pages with the page
+   allocator, because a block in a multi-page arena may not share
+   a page with the arena header.
+
+   Blocks bigger than the largest class are handled by
+   allocating contiguous pages with the page allocator and
+   sticking the allocation size at the beginning of the allocated
+   block's arena header. */
+
+/* Largest arena, in pages.  A power of 2, so that arenas do not
+   break up the page allocator's blocks. */
+#define MAX_ARENA_PAGES 16
+
+/* No size class is bigger than this many bytes. */
+#define MAX_CLASS_SIZE 8192
+
+/* Size classes are multiples of this many bytes. */
+#define CLASS_ALIGN 16
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	size_t arena_pages;         /* Number of pages in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Statistics, protected by `lock'. */
+	size_t arena_cnt;           /* Arenas allocated. */
+	size_t used_cnt;            /* Blocks in use. */
+	unsigned long long alloc_cnt; /* Blocks handed out so far. */
+	unsigned long long req_bytes; /* Bytes requested for those. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -58,25 +85,51 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[48];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index in descs[] of the smallest class that holds N *
+   CLASS_ALIGN bytes, for each N up to the largest class. */
+static uint8_t size_class[MAX_CLASS_SIZE / CLASS_ALIGN + 1];
+
+/* Blocks too big for any class, protected by big_lock. */
+static struct lock big_lock;
+static size_t big_cnt;          /* Big blocks in use. */
+static size_t big_pages;        /* Pages in those blocks. */
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static size_t arena_size (size_t block_size);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t block_size, i;
+	struct desc *d;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
+	for (block_size = CLASS_ALIGN; block_size <= MAX_CLASS_SIZE;
+			block_size = block_size < 128 ? block_size + CLASS_ALIGN
+			: ROUND_UP (block_size + block_size / 8, CLASS_ALIGN)) {
+		d = &descs[desc_cnt++];
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		d->arena_pages = arena_size (block_size);
+		d->blocks_per_arena = (d->arena_pages * PGSIZE - sizeof (struct arena))
+			/ block_size;
 		list_init (&d->free_list);
 		lock_init (&d->lock);
+		d->arena_cnt = d->used_cnt = 0;
+		d->alloc_cnt = d->req_bytes = 0;
+	}
+
+	d = descs;
+	for (i = 0; i * CLASS_ALIGN <= descs[desc_cnt - 1].block_size; i++) {
+		while (d->block_size < i * CLASS_ALIGN)
+			d++;
+		size_class[i] = d - descs;
 	}
+
+	lock_init (&big_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -93,10 +146,7 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > descs[desc_cnt - 1].block_size) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -109,8 +159,16 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		palloc_set_owner (a, 1, a);
+
+		lock_acquire (&big_lock);
+		big_cnt++;
+		big_pages += page_cnt;
+		lock_release (&big_lock);
 		return a + 1;
 	}
+	d = &descs[size_class[DIV_ROUND_UP (size, CLASS_ALIGN)]];
+	ASSERT (d->block_size >= size);
 
 	lock_acquire (&d->lock);
 
@@ -118,8 +176,8 @@ malloc (size_t size) {
 	if (list_empty (&d->free_list)) {
 		size_t i;
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
+		/* Allocate its pages. */
+		a = palloc_get_multiple (0, d->arena_pages);
 		if (a == NULL) {
 			lock_release (&d->lock);
 			return NULL;
@@ -129,16 +187,21 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = d;
 		a->free_cnt = d->blocks_per_arena;
+		palloc_set_owner (a, d->arena_pages, a);
 		for (i = 0; i < d->blocks_per_arena; i++) {
 			struct block *b = arena_to_block (a, i);
 			list_push_back (&d->free_list, &b->free_elem);
 		}
+		d->arena_cnt++;
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
 	a->free_cnt--;
+	d->used_cnt++;
+	d->alloc_cnt++;
+	d->req_bytes += size;
 	lock_release (&d->lock);
 	return b;
 }
@@ -217,6 +280,7 @@ free (void *p) {
 
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
+			d->used_cnt--;
 
 			/* If the arena is now entirely unused, free it. */
 			if (++a->free_cnt >= d->blocks_per_arena) {
@@ -227,22 +291,57 @@ free (void *p) {
 					struct block *b = arena_to_block (a, i);
 					list_remove (&b->free_elem);
 				}
-				palloc_free_page (a);
+				palloc_free_multiple (a, d->arena_pages);
+				d->arena_cnt--;
 			}
 
 			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
-			palloc_free_multiple (a, a->free_cnt);
+			size_t page_cnt = a->free_cnt;
+
+			lock_acquire (&big_lock);
+			big_cnt--;
+			big_pages -= page_cnt;
+			lock_release (&big_lock);
+
+			palloc_free_multiple (a, page_cnt);
 			return;
 		}
 	}
 }
+
+/* Prints, for each size class in use so far, how many blocks
+   and arenas it has and its internal fragmentation: the share of
+   the bytes handed out that callers did not ask for, over all
+   allocations so far. */
+void
+malloc_print_stats (void) {
+	struct desc *d;
+
+	for (d = descs; d < descs + desc_cnt; d++) {
+		unsigned long long given;
+
+		lock_acquire (&d->lock);
+		given = d->alloc_cnt * d->block_size;
+		if (d->alloc_cnt != 0)
+			printf ("Malloc: %zu-byte class: %zu blocks in use in %zu arenas "
+					"of %zu pages, %llu allocs, %llu%% internal fragmentation\n",
+					d->block_size, d->used_cnt, d->arena_cnt, d->arena_pages,
+					d->alloc_cnt, (given - d->req_bytes) * 100 / given);
+		lock_release (&d->lock);
+	}
+
+	lock_acquire (&big_lock);
+	printf ("Malloc: big blocks: %zu in use in %zu pages\n",
+			big_cnt, big_pages);
+	lock_release (&big_lock);
+}
 
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
-	struct arena *a = pg_round_down (b);
+	struct arena *a = palloc_get_owner (pg_round_down (b));
 
 	/* Check that the arena is valid. */
 	ASSERT (a != NULL);
@@ -250,8 +349,9 @@ block_to_arena (struct block *b) {
 
 	/* Check that the block is properly aligned for the arena. */
 	ASSERT (a->desc == NULL
-			|| (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-	ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+			|| ((uint8_t *) b - (uint8_t *) (a + 1))
+			% a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || (struct arena *) b == a + 1);
 
 	return a;
 }
@@ -266,3 +366,20 @@ arena_to_block (struct arena *a, size_t idx) {
 			+ sizeof *a
 			+ idx * a->desc->block_size);
 }
+
+/* Returns the number of pages in an arena for blocks of
+   BLOCK_SIZE bytes: the fewest that leave no more than an eighth
+   of the arena unused, or failing that MAX_ARENA_PAGES. */
+static size_t
+arena_size (size_t block_size) {
+	size_t pages;
+
+	for (pages = 1; pages < MAX_ARENA_PAGES; pages *= 2) {
+		size_t space = pages * PGSIZE - sizeof (struct arena);
+
+		if (space >= block_size && space % block_size <= pages * PGSIZE / 8)
+			break;
+	}
+	ASSERT (pages * PGSIZE - sizeof (struct arena) >= block_size);
+	return pages;
+}
@@ -2,6 +2,7 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -10,6 +11,7 @@
 #include "threads/init.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +26,71 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept in
+   blocks of 2**ORDER pages whose first page number is a multiple
+   of 2**ORDER, one free list per order.  A request for N pages
+   takes a block of the smallest order that fits, splitting a
+   larger one if need be, and gives back the pages past N at
+   once.  Freeing a block merges it with its buddy, the other
+   half of the block of the next order, for as long as the buddy
+   is free as a whole, so free memory does not stay chopped up
+   after a burst of small allocations.  Both take O(log n) time.
+
+   The pool lock is a spin lock because pages are freed from the
+   scheduler, with interrupts off, when dying threads are
+   reaped.
+
+   Zeroing a page costs more than allocating it, so each pool
+   also keeps a stock of free pages that are already zeroed,
+   which single-page PAL_ZERO requests take first.  The idle
+   thread fills the stock up to ZERO_HIGH pages, one page at a
+   time, so the zeroing only uses time that no thread wanted and
+   is charged to none: a zeroing thread would count towards the
+   load average and take its share of the CPU under "-mlfqs".  A
+   refill starts when a PAL_ZERO request leaves fewer than
+   ZERO_LOW pages in stock, and stops early rather than leave the
+   pool with ZERO_HIGH free pages or fewer.  Stocked pages count as in use
+   for the buddy allocator; an allocation that cannot be
+   satisfied otherwise gives them back to it and retries. */
+
+/* Largest block order.  A request for more than 2**MAX_ORDER
+   pages always fails. */
+#define MAX_ORDER 20
+
+/* Buddy state of one page. */
+struct buddy_page {
+	union {
+		struct list_elem elem;      /* If free, element in a free list. */
+		void *owner;                /* If in use, see palloc_set_owner(). */
+	};
+	int order;                      /* If the first page of a free
+	                                   block, its order, otherwise
+	                                   NOT_FREE. */
+};
+#define NOT_FREE (-1)
+
+/* Watermarks of a pool's stock of zeroed pages. */
+#define ZERO_LOW 16
+#define ZERO_HIGH 64
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	const char *name;               /* "kernel" or "user". */
+	struct spinlock lock;           /* Mutual exclusion. */
+	struct bitmap *used_map;        /* Bitmap of used or unusable pages. */
+	struct buddy_page *pages;       /* Buddy state of each page. */
+	struct list free_lists[MAX_ORDER + 1]; /* Free blocks, by order. */
+	size_t free_cnt;                /* # of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+
+	/* Stock of zeroed pages. */
+	struct list zeroed;             /* Zeroed pages, linked by `elem'. */
+	size_t zeroed_cnt;              /* # of pages in `zeroed'. */
+	bool refill_pending;            /* Stock to be refilled when idle. */
+	unsigned long long zero_hits;   /* PAL_ZERO pages taken from stock. */
+	unsigned long long zero_misses; /* PAL_ZERO pages zeroed on demand. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,10 +98,21 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
-static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
-static bool page_from_pool (const struct pool *, void *page);
+static void
+init_pool (struct pool *p, const char *name, void **bm_base,
+		uint64_t start, uint64_t end);
+
+static bool page_from_pool (const struct pool *, const void *page);
+static struct pool *page_pool (const void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static size_t page_pfn (const struct pool *, size_t page_idx);
+static bool take_zeroed (struct pool *, size_t *page_idx);
+static void drain_zeroed (struct pool *);
+static bool refill_zeroed (struct pool *);
+static void print_pool_stats (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -158,7 +229,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 						break;
 					}
 					// generate kernel pool
-					init_pool (&kernel_pool,
+					init_pool (&kernel_pool, "kernel",
 							&free_start, region_start, start + rem * PGSIZE);
 					// Transition to the next state
 					if (rem == size_in_pg) {
@@ -188,7 +259,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 	}
 
 	// generate the user pool
-	init_pool(&user_pool, &free_start, region_start, end);
+	init_pool(&user_pool, "user", &free_start, region_start, end);
 
 	// Iterate over the e820_entry. Setup the usable.
 	uint64_t usable_bound = (uint64_t) free_start;
@@ -223,12 +294,12 @@ split:
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,10 +333,27 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	bool zeroed = false;
+	size_t page_idx;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	spin_lock (&pool->lock);
+	if ((flags & PAL_ZERO) && page_cnt == 1) {
+		zeroed = take_zeroed (pool, &page_idx);
+		if (zeroed)
+			pool->zero_hits++;
+		else
+			pool->zero_misses++;
+		if (pool->zeroed_cnt < ZERO_LOW)
+			pool->refill_pending = true;
+	}
+	if (!zeroed) {
+		page_idx = pool_alloc (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) {
+			drain_zeroed (pool);
+			page_idx = pool_alloc (pool, page_cnt);
+		}
+	}
+	spin_unlock (&pool->lock);
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -274,7 +362,11 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 		pages = NULL;
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		size_t i;
+
+		for (i = 0; i < page_cnt; i++)
+			pool->pages[page_idx + i].owner = NULL;
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -306,20 +398,16 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 	if (pages == NULL || page_cnt == 0)
 		return;
 
-	if (page_from_pool (&kernel_pool, pages))
-		pool = &kernel_pool;
-	else if (page_from_pool (&user_pool, pages))
-		pool = &user_pool;
-	else
-		NOT_REACHED ();
-
+	pool = page_pool (pages);
 	page_idx = pg_no (pages) - pg_no (pool->base);
 
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	spin_lock (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_free (pool, page_idx, page_cnt);
+	spin_unlock (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -328,31 +416,290 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END */
+/* Zeroes one free page into the stock of a pool that is due for
+   a refill.  Returns false if neither pool is.  Called by the
+   idle thread, which checks between pages whether another thread
+   has become ready. */
+bool
+palloc_zero_idle (void) {
+	return refill_zeroed (&kernel_pool) || refill_zeroed (&user_pool);
+}
+
+/* Records OWNER as the owner of each of the PAGE_CNT allocated
+   pages starting at PAGES, so that palloc_get_owner() can find,
+   from any of the pages, the object a multi-page allocation
+   belongs to.  Costs no memory: a page's free-list element is
+   not used while the page is allocated. */
+void
+palloc_set_owner (void *pages, size_t page_cnt, void *owner) {
+	struct pool *pool = page_pool (pages);
+	size_t page_idx = pg_no (pages) - pg_no (pool->base);
+	size_t i;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+
+	for (i = 0; i < page_cnt; i++)
+		pool->pages[page_idx + i].owner = owner;
+}
+
+/* Returns the owner recorded by palloc_set_owner() for allocated
+   page PAGE, or a null pointer if none was recorded since the
+   page was allocated. */
+void *
+palloc_get_owner (const void *page) {
+	struct pool *pool = page_pool (page);
+	size_t page_idx = pg_no (page) - pg_no (pool->base);
+
+	ASSERT (bitmap_test (pool->used_map, page_idx));
+	return pool->pages[page_idx].owner;
+}
+
+/* Prints the number of free pages in each pool and how badly
+   they are fragmented. */
+void
+palloc_print_stats (void) {
+	print_pool_stats (&kernel_pool);
+	print_pool_stats (&user_pool);
+}
+
+/* Initializes pool P, named NAME, as starting at START and ending
+   at END, with every page unusable until pool_free() says
+   otherwise. */
 static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+init_pool (struct pool *p, const char *name, void **bm_base,
+		uint64_t start, uint64_t end) {
+  /* We'll put the pool's used_map and buddy state at *BM_BASE.
+     Calculate the space needed for both. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = bitmap_buf_size (pgcnt);
+	size_t bm_pages = DIV_ROUND_UP (bm_size, PGSIZE) * PGSIZE;
+	size_t pages_size = DIV_ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE) * PGSIZE;
+	size_t i;
 
-	lock_init(&p->lock);
+	p->name = name;
+	spin_lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->pages = *bm_base + bm_pages;
+	for (i = 0; i <= MAX_ORDER; i++)
+		list_init (&p->free_lists[i]);
+	p->free_cnt = 0;
 	p->base = (void *) start;
+	list_init (&p->zeroed);
+	p->zeroed_cnt = 0;
+	p->refill_pending = true;
+	p->zero_hits = p->zero_misses = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = NOT_FREE;
+
+	*bm_base += bm_pages + pages_size;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  POOL's lock must be held. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	int order = 0, j;
+	size_t page_idx;
+
+	ASSERT (spin_lock_held (&pool->lock));
+
+	if (page_cnt == 0)
+		return BITMAP_ERROR;
+	while (((size_t) 1 << order) < page_cnt)
+		if (++order > MAX_ORDER)
+			return BITMAP_ERROR;
+
+	/* Take the smallest free block that fits. */
+	for (j = order; j <= MAX_ORDER && list_empty (&pool->free_lists[j]); j++)
+		continue;
+	if (j > MAX_ORDER)
+		return BITMAP_ERROR;
+	page_idx = list_entry (list_pop_front (&pool->free_lists[j]),
+			struct buddy_page, elem) - pool->pages;
+	pool->pages[page_idx].order = NOT_FREE;
+	pool->free_cnt -= (size_t) 1 << j;
+
+	/* Split it down to ORDER, freeing the upper halves. */
+	while (j > order) {
+		size_t buddy;
+
+		j--;
+		buddy = page_idx + ((size_t) 1 << j);
+		pool->pages[buddy].order = j;
+		list_push_front (&pool->free_lists[j], &pool->pages[buddy].elem);
+		pool->free_cnt += (size_t) 1 << j;
+	}
+
+	/* Give back what PAGE_CNT does not need of the block. */
+	bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << order, true);
+	pool_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Returns the PAGE_CNT pages of POOL starting at PAGE_IDX, which
+   must be in use, to POOL's free lists, as the largest aligned
+   blocks they divide into.  POOL's lock must be held, except
+   while the pools are populated. */
+static void
+pool_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	while (page_cnt > 0) {
+		size_t pfn = page_pfn (pool, page_idx);
+		int order = 0;
+
+		while (order < MAX_ORDER
+				&& pfn % ((size_t) 2 << order) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Frees the block of 2**ORDER pages of POOL at PAGE_IDX, merging
+   it with its buddy for as long as the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+
+	pool->free_cnt += (size_t) 1 << order;
+	while (order < MAX_ORDER) {
+		size_t pfn = page_pfn (pool, page_idx);
+		size_t buddy = page_idx + ((pfn ^ ((size_t) 1 << order)) - pfn);
+
+		/* An unsigned wrap-around puts BUDDY past the end too. */
+		if (buddy >= page_cnt || pool->pages[buddy].order != order)
+			break;
+		list_remove (&pool->pages[buddy].elem);
+		pool->pages[buddy].order = NOT_FREE;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	pool->pages[page_idx].order = order;
+	list_push_front (&pool->free_lists[order], &pool->pages[page_idx].elem);
+}
 
-	*bm_base += bm_pages;
+/* Returns the physical page number of page PAGE_IDX of POOL.
+   Blocks are aligned on physical page numbers, not on pool
+   indexes. */
+static size_t
+page_pfn (const struct pool *pool, size_t page_idx) {
+	return pg_no (vtop (pool->base)) + page_idx;
+}
+
+/* Takes a page from POOL's stock of zeroed pages and stores its
+   index in *PAGE_IDX.  Returns false if the stock is empty.
+   POOL's lock must be held. */
+static bool
+take_zeroed (struct pool *pool, size_t *page_idx) {
+	ASSERT (spin_lock_held (&pool->lock));
+
+	if (list_empty (&pool->zeroed))
+		return false;
+	*page_idx = list_entry (list_pop_front (&pool->zeroed),
+			struct buddy_page, elem) - pool->pages;
+	pool->zeroed_cnt--;
+	return true;
+}
+
+/* Gives POOL's whole stock of zeroed pages back to the buddy
+   allocator.  POOL's lock must be held. */
+static void
+drain_zeroed (struct pool *pool) {
+	size_t page_idx;
+
+	while (take_zeroed (pool, &page_idx))
+		pool_free (pool, page_idx, 1);
+}
+
+/* If POOL's stock of zeroed pages is due for a refill, zeroes
+   one free page into it and returns true.  Ends the refill, and
+   returns false, once the stock holds ZERO_HIGH pages or the pool
+   runs low on free pages. */
+static bool
+refill_zeroed (struct pool *pool) {
+	size_t page_idx = BITMAP_ERROR;
+
+	spin_lock (&pool->lock);
+	if (pool->refill_pending) {
+		if (pool->zeroed_cnt < ZERO_HIGH && pool->free_cnt > ZERO_HIGH)
+			page_idx = pool_alloc (pool, 1);
+		if (page_idx == BITMAP_ERROR)
+			pool->refill_pending = false;
+	}
+	spin_unlock (&pool->lock);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	memset (pool->base + PGSIZE * page_idx, 0, PGSIZE);
+
+	spin_lock (&pool->lock);
+	list_push_front (&pool->zeroed, &pool->pages[page_idx].elem);
+	pool->zeroed_cnt++;
+	spin_unlock (&pool->lock);
+	return true;
+}
+
+/* Prints POOL's free pages, its free blocks of each order, how
+   fragmented it is (the share of free pages outside the largest
+   free block), and how its stock of zeroed pages has fared. */
+static void
+print_pool_stats (struct pool *pool) {
+	size_t blocks[MAX_ORDER + 1];
+	size_t free_cnt, largest = 0, zeroed_cnt;
+	unsigned long long hits, misses;
+	int order, top = 0;
+
+	spin_lock (&pool->lock);
+	free_cnt = pool->free_cnt;
+	zeroed_cnt = pool->zeroed_cnt;
+	hits = pool->zero_hits;
+	misses = pool->zero_misses;
+	for (order = 0; order <= MAX_ORDER; order++) {
+		blocks[order] = list_size (&pool->free_lists[order]);
+		if (blocks[order] != 0) {
+			largest = (size_t) 1 << order;
+			top = order;
+		}
+	}
+	spin_unlock (&pool->lock);
+
+	printf ("Palloc: %s pool: %zu pages free, largest block %zu pages, "
+			"%zu%% fragmented\n", pool->name, free_cnt, largest,
+			free_cnt != 0 ? (free_cnt - largest) * 100 / free_cnt : 0);
+	printf ("Palloc: %s pool: free blocks by order:", pool->name);
+	for (order = 0; order <= top; order++)
+		printf (" %zu", blocks[order]);
+	printf ("\n");
+	printf ("Palloc: %s pool: %zu zeroed pages in stock, %llu zeroed "
+			"allocations served from stock, %llu zeroed on demand\n",
+			pool->name, zeroed_cnt, hits, misses);
 }
 
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
-page_from_pool (const struct pool *pool, void *page) {
+page_from_pool (const struct pool *pool, const void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the pool that PAGE belongs to. */
+static struct pool *
+page_pool (const void *page) {
+	if (page_from_pool (&kernel_pool, page))
+		return &kernel_pool;
+	else if (page_from_pool (&user_pool, page))
+		return &user_pool;
+	else
+		NOT_REACHED ();
+}
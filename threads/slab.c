@@ -0,0 +1,253 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   malloc() rounds each request up to one of about 40 size
+   classes, roughly 12.5% apart, and carves blocks of that class
+   from arenas of one or more pages.  A structure that the kernel
+   allocates and frees all the time still pays for that rounding,
+   for sharing its class's lock with unrelated callers of a
+   similar size, and for an arena that goes back to the page
+   allocator as soon as its last block is freed, only to be taken
+   again on the next allocation.  A kmem_cache serves one kind of
+   object instead.
+
+   A cache carves one-page slabs into objects of exactly its
+   size.  Each slab begins with a header and keeps its free
+   objects on a list of its own.  Slabs that are neither full nor
+   empty sit on the cache's `partial' list, and allocation always
+   takes from there first, so that in-use objects pack into as few
+   slabs as possible and the rest can drain.  A slab whose last
+   object is freed moves to the `empty' list; up to
+   KMEM_EMPTY_MAX such slabs are kept for the next burst of
+   allocations, and any more go back to the page allocator.  Full
+   slabs are on no list: they are found again from the objects
+   freed into them.
+
+   If the cache has a constructor, it runs once on each object
+   when a slab is carved, not on each allocation.  The free-list
+   link lives in its own word after the object, so an object
+   keeps its constructed state while it is free, and the caller
+   must hand it back in that state.  Objects of caches without a
+   constructor have undefined contents when allocated. */
+
+/* Empty slabs a cache keeps instead of freeing them. */
+#define KMEM_EMPTY_MAX 2
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of its page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* In `partial' or `empty', unless full. */
+	size_t free_cnt;            /* Number of free objects. */
+	void *free;                 /* First free object. */
+};
+
+/* All caches, for kmem_print_stats(). */
+static struct kmem_cache *all_caches;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void **obj_link (struct kmem_cache *, void *);
+
+/* Initializes cache C, named NAME, to hand out objects of SIZE
+   bytes, each set up once by CTOR if it is nonnull.  C must stay
+   allocated for as long as the kernel runs. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+		kmem_ctor *ctor) {
+	enum intr_level old_level;
+
+	ASSERT (c != NULL);
+	ASSERT (name != NULL);
+	ASSERT (size > 0);
+
+	strlcpy (c->name, name, sizeof c->name);
+	c->obj_size = size;
+	c->slot_size = ROUND_UP (size, sizeof (void *)) + sizeof (void *);
+	c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->slot_size;
+	ASSERT (c->objs_per_slab > 0);
+	c->ctor = ctor;
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	c->slab_cnt = 0;
+	c->active_cnt = 0;
+	c->alloc_cnt = 0;
+	c->grow_cnt = 0;
+	c->shrink_cnt = 0;
+
+	old_level = intr_disable ();
+	c->next = all_caches;
+	all_caches = c;
+	intr_set_level (old_level);
+}
+
+/* Takes an object from cache C and returns it, or returns a null
+   pointer if no memory is available.  If C has a constructor,
+   the object is in its constructed state. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		c->empty_cnt--;
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		/* Run the constructors without holding the lock. */
+		lock_release (&c->lock);
+		s = slab_create (c);
+		if (s == NULL)
+			return NULL;
+		lock_acquire (&c->lock);
+		c->slab_cnt++;
+		c->grow_cnt++;
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	obj = s->free;
+	s->free = *obj_link (c, obj);
+	if (--s->free_cnt == 0)
+		list_remove (&s->elem);
+	c->active_cnt++;
+	c->alloc_cnt++;
+	lock_release (&c->lock);
+
+	return obj;
+}
+
+/* Returns OBJ, which must have come from kmem_cache_alloc(C), to
+   cache C.  If C has a constructor, OBJ must be back in its
+   constructed state.  A null OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	bool was_full;
+	void *page = NULL;
+
+	ASSERT (c != NULL);
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   that would destroy its constructed state. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	was_full = s->free_cnt == 0;
+	*obj_link (c, obj) = s->free;
+	s->free = obj;
+	s->free_cnt++;
+	c->active_cnt--;
+
+	if (s->free_cnt == c->objs_per_slab) {
+		if (!was_full)
+			list_remove (&s->elem);
+		if (c->empty_cnt < KMEM_EMPTY_MAX) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else {
+			c->slab_cnt--;
+			c->shrink_cnt++;
+			page = s;
+		}
+	} else if (was_full) {
+		/* Nearly full: fill it up before the emptier ones. */
+		list_push_front (&c->partial, &s->elem);
+	}
+	lock_release (&c->lock);
+
+	if (page != NULL) {
+		s->magic = 0;
+		palloc_free_page (page);
+	}
+}
+
+/* Prints statistics for every cache. */
+void
+kmem_print_stats (void) {
+	struct kmem_cache *c;
+
+	for (c = all_caches; c != NULL; c = c->next)
+		printf ("Slab %s: %zu of %zu objects in use, %zu slabs "
+				"(%zu empty), %llu allocs, %llu grows, %llu shrinks\n",
+				c->name, c->active_cnt, c->slab_cnt * c->objs_per_slab,
+				c->slab_cnt, c->empty_cnt,
+				c->alloc_cnt, c->grow_cnt, c->shrink_cnt);
+}
+
+/* Obtains a page for cache C and carves it into free objects,
+   constructing each of them.  Returns the new slab, which is on
+   no list, or a null pointer if no page is available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	uint8_t *base;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->objs_per_slab;
+	s->free = NULL;
+
+	/* Link the objects in address order. */
+	base = (uint8_t *) (s + 1);
+	for (i = c->objs_per_slab; i-- > 0; ) {
+		void *obj = base + i * c->slot_size;
+
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*obj_link (c, obj) = s->free;
+		s->free = obj;
+	}
+	return s;
+}
+
+/* Returns the slab that OBJ, an object of cache C, belongs to. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT (((uint8_t *) obj - (uint8_t *) (s + 1)) % c->slot_size == 0);
+
+	return s;
+}
+
+/* Returns the address of the free-list link of OBJ, an object of
+   cache C, which follows the object itself. */
+static void **
+obj_link (struct kmem_cache *c, void *obj) {
+	return (void **) ((uint8_t *) obj + c->slot_size - sizeof (void *));
+}
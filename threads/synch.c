@@ -29,8 +29,21 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* Stamps waiters in the order they start waiting, so that
+   waiters of equal priority are woken first-come, first-served. */
+static uint64_t wait_seq;
+
+static bool sema_waiter_less(const struct heap_elem *,
+							 const struct heap_elem *, void *aux);
+static bool cond_waiter_less(const struct heap_elem *,
+							 const struct heap_elem *, void *aux);
+static void cond_take_waiter(struct heap_elem *, void *list_);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +59,7 @@ void sema_init(struct semaphore *sema, unsigned value)
 	ASSERT(sema != NULL);
 
 	sema->value = value;
-	list_init(&sema->waiters);
+	heap_init(&sema->waiters, sema_waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -67,14 +80,57 @@ void sema_down(struct semaphore *sema)
 	old_level = intr_disable();
 	while (sema->value == 0)
 	{
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, thread_priority_compare, NULL);
+		struct thread *cur = thread_current();
+
+		cur->wait_on_sema = sema;
+		cur->wait_seq = wait_seq++;
+		heap_push(&sema->waiters, &cur->wait_elem);
 		thread_block();
 	}
 	sema->value--;
 	intr_set_level(old_level);
 }
 
+/* Down or "P" operation on a semaphore, giving up after TICKS
+   timer ticks.  Returns true if SEMA was decremented, false if
+   the time ran out first.  With TICKS at most 0, acts like
+   sema_try_down().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool sema_down_timeout(struct semaphore *sema, int64_t ticks)
+{
+	enum intr_level old_level;
+	bool success = true;
+
+	ASSERT(sema != NULL);
+	ASSERT(!intr_context());
+
+	old_level = intr_disable();
+	if (sema->value == 0 && ticks > 0)
+		thread_timeout_start(timer_ticks() + ticks);
+	while (sema->value == 0)
+	{
+		struct thread *cur = thread_current();
+
+		if (ticks <= 0 || thread_timeout_expired())
+		{
+			success = false;
+			break;
+		}
+		cur->wait_on_sema = sema;
+		cur->wait_seq = wait_seq++;
+		heap_push(&sema->waiters, &cur->wait_elem);
+		thread_block();
+	}
+	if (success)
+		sema->value--;
+	if (ticks > 0)
+		thread_timeout_cancel();
+	intr_set_level(old_level);
+	return success;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -105,24 +161,76 @@ bool sema_try_down(struct semaphore *sema)
 
    This function may be called from an interrupt handler. */
 void sema_up(struct semaphore *sema)
+{
+	sema_up_n(sema, 1);
+}
+
+/* Increments SEMA's value by N and wakes up the N highest
+   priority threads of those waiting for SEMA, or all of them if
+   there are fewer.
+
+   This function may be called from an interrupt handler. */
+void sema_up_n(struct semaphore *sema, unsigned n)
 {
 	enum intr_level old_level;
+	unsigned i;
 
 	ASSERT(sema != NULL);
 
 	old_level = intr_disable();
-	if (!list_empty(&sema->waiters))
+	for (i = 0; i < n && !heap_empty(&sema->waiters); i++)
 	{
-		list_sort(&sema->waiters, thread_priority_compare, NULL);
+		struct thread *t = heap_entry(heap_pop(&sema->waiters),
+									  struct thread, wait_elem);
 
-		thread_unblock(list_entry(list_pop_front(&sema->waiters),
-								  struct thread, elem));
+		t->wait_on_sema = NULL;
+		thread_unblock(t);
 	}
-	sema->value++;
+	sema->value += n;
 	thread_test_preemption();
 	intr_set_level(old_level);
 }
 
+/* Restores the position of T, whose priority has just changed,
+   among the waiters of the semaphore and of the condition
+   variable it waits for, if any.  Interrupts must be off. */
+void sema_waiter_update(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (t->wait_on_sema != NULL)
+		heap_update(&t->wait_on_sema->waiters, &t->wait_elem);
+	if (t->wait_cond != NULL)
+		heap_update(&t->wait_cond->waiters, t->wait_cond_elem);
+}
+
+/* Takes T, whose timeout has just expired, off the semaphore it
+   waits for, if any.  Interrupts must be off. */
+void sema_waiter_cancel(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (t->wait_on_sema != NULL)
+	{
+		heap_remove(&t->wait_on_sema->waiters, &t->wait_elem);
+		t->wait_on_sema = NULL;
+	}
+}
+
+/* Orders a semaphore's waiters by priority, highest first, then
+   by the time they started waiting. */
+static bool
+sema_waiter_less(const struct heap_elem *a_, const struct heap_elem *b_,
+				 void *aux UNUSED)
+{
+	const struct thread *a = heap_entry(a_, struct thread, wait_elem);
+	const struct thread *b = heap_entry(b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->wait_seq < b->wait_seq;
+}
+
 static void sema_test_helper(void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -159,6 +267,65 @@ sema_test_helper(void *sema_)
 	}
 }
 
+static void sema_bench_helper(void *sema_);
+
+/* Number of round trips timed by sema_switch_bench(). */
+#define SWITCH_BENCH_ROUNDS 1000
+
+/* Measures the cost of a thread switch by making control
+   ping-pong between a pair of threads, as in sema_self_test(),
+   and prints the average cycles per switch.  Runs once with every
+   switch going through an intr_frame and iretq and once with the
+   switch_threads() fast path. */
+void sema_switch_bench(void)
+{
+	int pass;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		struct semaphore sema[2];
+		uint64_t start, cycles;
+		int i;
+
+		thread_iret_switch = pass == 0;
+		sema_init(&sema[0], 0);
+		sema_init(&sema[1], 0);
+		thread_create("switch-bench", PRI_DEFAULT, sema_bench_helper, &sema);
+
+		/* The first round starts the helper, which always takes
+		   the iretq path, so leave it out. */
+		sema_up(&sema[0]);
+		sema_down(&sema[1]);
+
+		start = rdtsc();
+		for (i = 0; i < SWITCH_BENCH_ROUNDS; i++)
+		{
+			sema_up(&sema[0]);
+			sema_down(&sema[1]);
+		}
+		cycles = rdtsc() - start;
+
+		printf("Thread switch via %s: %llu cycles\n",
+			   pass == 0 ? "iretq" : "switch_threads",
+			   cycles / (2 * SWITCH_BENCH_ROUNDS));
+	}
+	thread_iret_switch = false;
+}
+
+/* Thread function used by sema_switch_bench(). */
+static void
+sema_bench_helper(void *sema_)
+{
+	struct semaphore *sema = sema_;
+	int i;
+
+	for (i = 0; i < SWITCH_BENCH_ROUNDS + 1; i++)
+	{
+		sema_down(&sema[0]);
+		sema_up(&sema[1]);
+	}
+}
+
 /* Initializes LOCK.  A lock can be held by at most a single
    thread at any given time.  Our locks are not "recursive", that
    is, it is an error for the thread currently holding a lock to
@@ -180,6 +347,7 @@ void lock_init(struct lock *lock)
 
 	lock->holder = NULL;
 	sema_init(&lock->semaphore, 1);
+	heap_init(&lock->donors, thread_compare_donate_priority, NULL);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -203,18 +371,49 @@ void lock_acquire(struct lock *lock)
 		return;
 	}
 
-	struct thread *cur = thread_current();
-	if (lock->holder)
+	enum intr_level old_level = intr_disable();
+	if (lock->semaphore.value == 0)
+		donate_priority(lock);
+
+	sema_down(&lock->semaphore);
+	receive_donation(lock);
+	intr_set_level(old_level);
+}
+
+/* Acquires LOCK like lock_acquire(), but gives up after TICKS
+   timer ticks.  Returns true if LOCK was acquired, false if the
+   time ran out first, in which case the priority the thread
+   donated while it waited is taken back.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool lock_acquire_timeout(struct lock *lock, int64_t ticks)
+{
+	bool success;
+
+	ASSERT(lock != NULL);
+	ASSERT(!intr_context());
+	ASSERT(!lock_held_by_current_thread(lock));
+
+	if (thread_mlfqs)
 	{
-		cur->wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donations, &cur->donation_elem,
-							thread_compare_donate_priority, 0);
-		donate_priority();
+		success = sema_down_timeout(&lock->semaphore, ticks);
+		if (success)
+			lock->holder = thread_current();
+		return success;
 	}
 
-	sema_down(&lock->semaphore);
-	cur->wait_on_lock = NULL;
-	lock->holder = cur;
+	enum intr_level old_level = intr_disable();
+	if (lock->semaphore.value == 0 && ticks > 0)
+		donate_priority(lock);
+
+	success = sema_down_timeout(&lock->semaphore, ticks);
+	if (success)
+		receive_donation(lock);
+	else if (thread_current()->wait_on_lock == lock)
+		cancel_donation(lock);
+	intr_set_level(old_level);
+	return success;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -232,7 +431,16 @@ bool lock_try_acquire(struct lock *lock)
 
 	success = sema_try_down(&lock->semaphore);
 	if (success)
-		lock->holder = thread_current();
+	{
+		if (thread_mlfqs)
+			lock->holder = thread_current();
+		else
+		{
+			enum intr_level old_level = intr_disable();
+			receive_donation(lock);
+			intr_set_level(old_level);
+		}
+	}
 	return success;
 }
 
@@ -254,10 +462,10 @@ void lock_release(struct lock *lock)
 		return;
 	}
 
+	enum intr_level old_level = intr_disable();
 	remove_with_lock(lock);
-	refresh_priority();
-
 	sema_up(&lock->semaphore);
+	intr_set_level(old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -273,8 +481,11 @@ bool lock_held_by_current_thread(const struct lock *lock)
 /* One semaphore in a list. */
 struct semaphore_elem
 {
-	struct list_elem elem;		/* List element. */
-	struct semaphore semaphore; /* This semaphore. */
+	struct heap_elem elem;		 /* Element in the waiters heap. */
+	struct semaphore semaphore;	 /* This semaphore. */
+	struct thread *thread;		 /* Waiting thread. */
+	uint64_t seq;				 /* When the wait started. */
+	struct semaphore_elem *next; /* Next in cond_broadcast()'s list. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -284,7 +495,7 @@ void cond_init(struct condition *cond)
 {
 	ASSERT(cond != NULL);
 
-	list_init(&cond->waiters);
+	heap_init(&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -307,20 +518,45 @@ void cond_init(struct condition *cond)
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-bool sema_compare_priority(const struct list_elem *l, const struct list_elem *s, void *aux UNUSED)
+void cond_wait(struct condition *cond, struct lock *lock)
 {
-	struct semaphore_elem *l_sema = list_entry(l, struct semaphore_elem, elem);
-	struct semaphore_elem *s_sema = list_entry(s, struct semaphore_elem, elem);
+	struct semaphore_elem waiter;
+	enum intr_level old_level;
+
+	ASSERT(cond != NULL);
+	ASSERT(lock != NULL);
+	ASSERT(!intr_context());
+	ASSERT(lock_held_by_current_thread(lock));
 
-	struct list *waiter_l_sema = &(l_sema->semaphore.waiters);
-	struct list *waiter_s_sema = &(s_sema->semaphore.waiters);
+	sema_init(&waiter.semaphore, 0);
+	waiter.thread = thread_current();
 
-	return list_entry(list_begin(waiter_l_sema), struct thread, elem)->priority > list_entry(list_begin(waiter_s_sema), struct thread, elem)->priority;
+	/* Donations may reorder the waiters at any time, so the heap
+	   is only touched with interrupts off. */
+	old_level = intr_disable();
+	waiter.seq = wait_seq++;
+	waiter.thread->wait_cond = cond;
+	waiter.thread->wait_cond_elem = &waiter.elem;
+	heap_push(&cond->waiters, &waiter.elem);
+	intr_set_level(old_level);
+
+	lock_release(lock);
+	sema_down(&waiter.semaphore);
+	lock_acquire(lock);
 }
 
-void cond_wait(struct condition *cond, struct lock *lock)
+/* Like cond_wait(), but stops waiting for COND after TICKS timer
+   ticks.  Returns true if COND was signaled, false if the time
+   ran out first.  Either way, LOCK is held again on return.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool cond_wait_timeout(struct condition *cond, struct lock *lock,
+					   int64_t ticks)
 {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
+	bool signaled;
 
 	ASSERT(cond != NULL);
 	ASSERT(lock != NULL);
@@ -328,11 +564,32 @@ void cond_wait(struct condition *cond, struct lock *lock)
 	ASSERT(lock_held_by_current_thread(lock));
 
 	sema_init(&waiter.semaphore, 0);
-	// list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered(&cond->waiters, &waiter.elem, sema_compare_priority, NULL);
+	waiter.thread = thread_current();
+
+	old_level = intr_disable();
+	waiter.seq = wait_seq++;
+	waiter.thread->wait_cond = cond;
+	waiter.thread->wait_cond_elem = &waiter.elem;
+	heap_push(&cond->waiters, &waiter.elem);
+	intr_set_level(old_level);
+
 	lock_release(lock);
-	sema_down(&waiter.semaphore);
+	sema_down_timeout(&waiter.semaphore, ticks);
+
+	/* A signal that took the waiter off COND counts even if the
+	   timeout expired before its sema_up().  The signaler holds
+	   LOCK until then, so WAITER outlives it. */
+	old_level = intr_disable();
+	signaled = waiter.thread->wait_cond == NULL;
+	if (!signaled)
+	{
+		heap_remove(&cond->waiters, &waiter.elem);
+		waiter.thread->wait_cond = NULL;
+	}
+	intr_set_level(old_level);
+
 	lock_acquire(lock);
+	return signaled;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
@@ -344,19 +601,24 @@ void cond_wait(struct condition *cond, struct lock *lock)
    interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED)
 {
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level;
+
 	ASSERT(cond != NULL);
 	ASSERT(lock != NULL);
 	ASSERT(!intr_context());
 	ASSERT(lock_held_by_current_thread(lock));
 
-	if (!list_empty(&cond->waiters))
+	old_level = intr_disable();
+	if (!heap_empty(&cond->waiters))
 	{
-		list_sort(&cond->waiters, sema_compare_priority, NULL);
-
-		sema_up(&list_entry(list_pop_front(&cond->waiters),
-							struct semaphore_elem, elem)
-					 ->semaphore);
+		waiter = heap_entry(heap_pop(&cond->waiters), struct semaphore_elem, elem);
+		waiter->thread->wait_cond = NULL;
 	}
+	intr_set_level(old_level);
+
+	if (waiter != NULL)
+		sema_up(&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -367,9 +629,322 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED)
    interrupt handler. */
 void cond_broadcast(struct condition *cond, struct lock *lock)
 {
+	struct semaphore_elem *waiters = NULL;
+	enum intr_level old_level;
+
 	ASSERT(cond != NULL);
 	ASSERT(lock != NULL);
+	ASSERT(!intr_context());
+	ASSERT(lock_held_by_current_thread(lock));
+
+	/* Take all waiters at once, then wake them.  They are woken
+	   in arbitrary order, and each sema_up() may preempt us
+	   before the rest are woken.  Priority order is restored
+	   when they reacquire LOCK, whose waiters are ordered by
+	   priority. */
+	old_level = intr_disable();
+	heap_clear(&cond->waiters, cond_take_waiter, &waiters);
+	intr_set_level(old_level);
+
+	while (waiters != NULL)
+	{
+		struct semaphore_elem *waiter = waiters;
+
+		waiters = waiter->next;
+		sema_up(&waiter->semaphore);
+	}
+}
+
+/* Detaches the waiter in E from the condition variable it waits
+   for and pushes it onto the list at *LIST_.  Used by
+   cond_broadcast(). */
+static void
+cond_take_waiter(struct heap_elem *e, void *list_)
+{
+	struct semaphore_elem **list = list_;
+	struct semaphore_elem *waiter = heap_entry(e, struct semaphore_elem, elem);
+
+	waiter->thread->wait_cond = NULL;
+	waiter->next = *list;
+	*list = waiter;
+}
+
+/* Orders a condition variable's waiters by priority, highest
+   first, then by the time they started waiting. */
+static bool
+cond_waiter_less(const struct heap_elem *a_, const struct heap_elem *b_,
+				 void *aux UNUSED)
+{
+	const struct semaphore_elem *a = heap_entry(a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b = heap_entry(b_, struct semaphore_elem, elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority > b->thread->priority;
+	return a->seq < b->seq;
+}
+
+/* Initializes RWLOCK as held by nobody. */
+void rwlock_init(struct rwlock *rwlock)
+{
+	ASSERT(rwlock != NULL);
+
+	lock_init(&rwlock->lock);
+	rwlock->readers = 0;
+	list_init(&rwlock->holders);
+	rwlock->writer = NULL;
+	sema_init(&rwlock->drained, 0);
+}
+
+/* Returns the running thread's read hold on RWLOCK, or a null
+   pointer if it does not hold RWLOCK for reading.  If FREE is
+   true and there is no such hold, returns an unused hold slot
+   instead. */
+static struct rwlock_hold *
+rwlock_find_hold(struct rwlock *rwlock, bool free)
+{
+	struct thread *cur = thread_current();
+	struct rwlock_hold *unused = NULL;
+	int i;
+
+	for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+	{
+		struct rwlock_hold *hold = &cur->read_holds[i];
+
+		if (hold->rwlock == rwlock)
+			return hold;
+		if (hold->rwlock == NULL && unused == NULL)
+			unused = hold;
+	}
+	return free ? unused : NULL;
+}
+
+/* Acquires RWLOCK for reading, sleeping until no writer holds it
+   or waits for it.  A thread that already holds RWLOCK for
+   reading acquires it again at once, even if a writer waits.  A
+   thread may hold at most RWLOCK_HOLD_MAX different rwlocks for
+   reading at a time.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rwlock)
+{
+	struct rwlock_hold *hold;
+	enum intr_level old_level;
+
+	ASSERT(rwlock != NULL);
+	ASSERT(!intr_context());
+
+	hold = rwlock_find_hold(rwlock, false);
+	if (hold != NULL)
+	{
+		hold->depth++;
+		return;
+	}
+
+	lock_acquire(&rwlock->lock);
+	hold = rwlock_find_hold(rwlock, true);
+	if (hold == NULL)
+		PANIC("too many reader-writer locks held for reading");
+	old_level = intr_disable();
+	hold->rwlock = rwlock;
+	hold->depth = 1;
+	hold->thread = thread_current();
+	list_push_back(&rwlock->holders, &hold->elem);
+	rwlock->readers++;
+	intr_set_level(old_level);
+	lock_release(&rwlock->lock);
+}
+
+/* Releases RWLOCK, held for reading by the current thread.  If a
+   writer is waiting, the priority it lent the thread is taken
+   back. */
+void rwlock_release_read(struct rwlock *rwlock)
+{
+	struct rwlock_hold *hold;
+	enum intr_level old_level;
+
+	ASSERT(rwlock != NULL);
+
+	hold = rwlock_find_hold(rwlock, false);
+	ASSERT(hold != NULL);
+	if (--hold->depth > 0)
+		return;
+
+	old_level = intr_disable();
+	list_remove(&hold->elem);
+	hold->rwlock = NULL;
+	if (!thread_mlfqs)
+		refresh_priority(thread_current());
+	if (--rwlock->readers == 0 && rwlock->writer != NULL)
+	{
+		rwlock->writer = NULL;
+		sema_up(&rwlock->drained);
+	}
+	intr_set_level(old_level);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.  While it waits for readers to leave, it donates its
+   priority to them.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rwlock)
+{
+	struct thread *cur = thread_current();
+	enum intr_level old_level;
+
+	ASSERT(rwlock != NULL);
+	ASSERT(!intr_context());
+	ASSERT(rwlock_find_hold(rwlock, false) == NULL);
+
+	/* Holding the lock keeps new readers out. */
+	lock_acquire(&rwlock->lock);
+	old_level = intr_disable();
+	if (rwlock->readers > 0)
+	{
+		rwlock->writer = cur;
+		cur->wait_on_rwlock = rwlock;
+		if (!thread_mlfqs)
+			donate_to_readers(rwlock);
+		sema_down(&rwlock->drained);
+		cur->wait_on_rwlock = NULL;
+	}
+	intr_set_level(old_level);
+}
+
+/* Releases RWLOCK, held for writing by the current thread. */
+void rwlock_release_write(struct rwlock *rwlock)
+{
+	ASSERT(rwlock_held_for_write(rwlock));
+
+	lock_release(&rwlock->lock);
+}
+
+/* Returns true if the current thread holds RWLOCK for writing. */
+bool rwlock_held_for_write(const struct rwlock *rwlock)
+{
+	ASSERT(rwlock != NULL);
+
+	return lock_held_by_current_thread(&rwlock->lock) && rwlock->readers == 0;
+}
+
+/* Initializes spin lock LOCK as released. */
+void spin_lock_init(struct spinlock *lock)
+{
+	ASSERT(lock != NULL);
+
+	lock->locked = 0;
+	lock->holder = NULL;
+	lock->old_level = INTR_OFF;
+}
+
+/* Acquires LOCK, spinning until it becomes available.  Disables
+   interrupts on this CPU until the matching spin_unlock().
+
+   Spin locks are not recursive: acquiring one already held by
+   this CPU deadlocks, which the assertion below catches. */
+void spin_lock(struct spinlock *lock)
+{
+	enum intr_level old_level;
+
+	ASSERT(lock != NULL);
+
+	old_level = intr_disable();
+	ASSERT(!spin_lock_held(lock));
+
+	for (;;)
+	{
+		int locked = 1;
+
+		/* xchg with a memory operand is implicitly locked. */
+		asm volatile("xchgl %0, %1" : "+r"(locked), "+m"(lock->locked) : : "memory");
+		if (locked == 0)
+			break;
+		while (lock->locked)
+			asm volatile("pause");
+	}
+
+	lock->holder = this_cpu();
+	lock->old_level = old_level;
+}
+
+/* Releases LOCK, which must be held by this CPU, and restores
+   the interrupt level from before spin_lock(). */
+void spin_unlock(struct spinlock *lock)
+{
+	enum intr_level old_level;
+
+	ASSERT(lock != NULL);
+	ASSERT(spin_lock_held(lock));
+
+	old_level = lock->old_level;
+	lock->holder = NULL;
+	barrier();
+	lock->locked = 0;
+	intr_set_level(old_level);
+}
+
+/* Returns true if this CPU holds LOCK.  Must be called with
+   interrupts off, or the answer may be stale. */
+bool spin_lock_held(const struct spinlock *lock)
+{
+	ASSERT(lock != NULL);
+
+	return lock->locked && lock->holder == this_cpu();
+}
 
-	while (!list_empty(&cond->waiters))
-		cond_signal(cond, lock);
+/* Initializes SEQ with no writer active. */
+void seqlock_init(struct seqlock *seq)
+{
+	ASSERT(seq != NULL);
+
+	seq->sequence = 0;
+	spin_lock_init(&seq->lock);
+}
+
+/* Starts a read of the data SEQ protects and returns the value
+   to pass to seqlock_read_retry() once the data has been read.
+   Waits for a write in progress on another CPU to finish.
+
+   Never disables interrupts and never writes to memory, so any
+   number of readers on any number of CPUs proceed in parallel.
+   Only compiler barriers are needed because x86 does not reorder
+   loads with other loads, nor stores with other stores. */
+unsigned seqlock_read_begin(const struct seqlock *seq)
+{
+	unsigned start;
+
+	while ((start = seq->sequence) & 1)
+		asm volatile("pause");
+	barrier();
+	return start;
+}
+
+/* Returns true if a writer changed the data SEQ protects since
+   seqlock_read_begin() returned START, in which case what was
+   read may be torn and the read must be retried. */
+bool seqlock_read_retry(const struct seqlock *seq, unsigned start)
+{
+	barrier();
+	return seq->sequence != start;
+}
+
+/* Starts a write of the data SEQ protects.  Writers exclude each
+   other through SEQ's spin lock, which also keeps interrupts off
+   until seqlock_write_end(), so that a reader in an interrupt
+   handler never spins on a write its own CPU left half done. */
+void seqlock_write_begin(struct seqlock *seq)
+{
+	spin_lock(&seq->lock);
+	seq->sequence++;
+	barrier();
+}
+
+/* Ends a write started with seqlock_write_begin(). */
+void seqlock_write_end(struct seqlock *seq)
+{
+	barrier();
+	seq->sequence++;
+	spin_unlock(&seq->lock);
 }
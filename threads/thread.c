@@ -3,14 +3,20 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -25,15 +31,22 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Per-CPU scheduler state, including each CPU's run queue of
+   processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  The kernel is
+   uniprocessor and this is groundwork only (see threads/cpu.h),
+   so cpu_cnt is 1. */
+struct cpu cpus[CPU_MAX];
+unsigned cpu_cnt;
 
 static struct list all_list;
-static struct list sleep_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Threads blocked in thread_sleep(), as a min-heap keyed on
+   `wakeup', and the earliest of those wakeups (INT64_MAX if no
+   thread is sleeping).  The timer interrupt only has to look at
+   threads whose deadline has passed. */
+static struct heap sleep_queue;
+static int64_t next_wakeup;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -41,23 +54,99 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
-/* Thread destruction requests */
+/* Thread destruction requests, shared by all CPUs. */
 static struct list destruction_req;
-
-/* Statistics. */
-static long long idle_ticks;   /* # of timer ticks spent idle. */
-static long long kernel_ticks; /* # of timer ticks in kernel threads. */
-static long long user_ticks;   /* # of timer ticks in user programs. */
+static struct spinlock destruction_lock;
+
+/* Pages of destroyed threads, kept for reuse by thread_create()
+   instead of going back to the page allocator, up to
+   THREAD_PAGE_CACHE_MAX of them. */
+#define THREAD_PAGE_CACHE_MAX 16
+static void *thread_page_cache[THREAD_PAGE_CACHE_MAX];
+static size_t thread_page_cache_cnt;
+static struct spinlock thread_page_lock;
+static long long thread_page_hits;	 /* # of pages taken from the cache. */
+static long long thread_page_misses; /* # of pages from palloc. */
+
+/* Pages of destroyed threads that did not fit in the page cache.
+   The scheduler runs with interrupts off and must not up a
+   semaphore, so it only lists them here, under thread_page_lock,
+   and sets reap_pending; the next timer tick queues reap_work,
+   which gives them back to the page allocator. */
+static struct list reap_list;
+static bool reap_pending;
+static struct workqueue reap_wq;
+static struct work reap_work;
+
+/* Scheduler statistics summed over threads that have exited. */
+static struct sched_stats exited_sched_stats;
+static struct spinlock sched_stats_lock;
 
 /* Scheduling. */
-#define TIME_SLICE 4		  /* # of timer ticks to give each thread. */
-static unsigned thread_ticks; /* # of timer ticks since last yield. */
+#define TIME_SLICE 4 /* # of timer ticks to give each thread. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* If true, every switch goes through thread_launch(), which saves
+   the whole register state in an intr_frame and resumes the next
+   thread with iretq.  If false (default), switches between
+   threads that have run before use switch_threads(), which only
+   saves callee-saved registers.  Only sema_switch_bench() sets it,
+   to measure the difference. */
+bool thread_iret_switch;
+
+/* Completely fair scheduler.  A thread's vruntime advances by
+   CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT / weight per tick it
+   runs, so vruntime is measured in 1/CFS_TICK_VRUNTIME ticks of a
+   nice-0 thread.  Every runnable thread gets a turn within
+   CFS_LATENCY ticks, in a slice proportional to its weight but no
+   shorter than CFS_MIN_GRANULARITY. */
+#define CFS_NICE_0_WEIGHT 1024
+#define CFS_TICK_VRUNTIME 1024
+#define CFS_LATENCY 8		  /* Target scheduling period, in ticks. */
+#define CFS_MIN_GRANULARITY 1 /* Shortest slice, in ticks. */
+
+/* A woken thread preempts the running one only if it is at least
+   this much vruntime behind, to avoid over-scheduling. */
+#define CFS_WAKEUP_GRAN CFS_TICK_VRUNTIME
+
+/* A thread waking from sleep is placed at most this far behind
+   min_vruntime, so it runs soon but cannot bank sleep time. */
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * CFS_TICK_VRUNTIME / 2)
+
+/* Earliest-deadline-first class.  Admission control keeps the
+   sum of budget / period over all threads in the class, counted
+   in units of 1/EDF_UTIL_SCALE and rounded up per thread, at or
+   below EDF_UTIL_SCALE, so that every admitted thread can get its
+   budget in each period. */
+#define EDF_UTIL_SCALE (1 << 20)
+static unsigned long edf_utilization; /* Protected by disabling interrupts. */
+
+/* recent_cpu is decayed once a second, but only for threads that
+   can run: a blocked thread's recent_cpu and priority are brought
+   up to date when it is unblocked.  For that, each thread records
+   in `mlfqs_epoch' the last second it was decayed at, and the
+   decay factor of each of the last MLFQS_HISTORY seconds is kept
+   here, indexed by second modulo MLFQS_HISTORY.
+
+   So that a thread never needs a factor that has been dropped,
+   blocked threads are also kept in mlfqs_blocked[], indexed by
+   their `mlfqs_epoch' modulo MLFQS_HISTORY.  Before a second's
+   factor is overwritten, the threads that may still need it are
+   caught up.  Each blocked thread thus costs one catch-up per
+   MLFQS_HISTORY seconds, and catching up stays exact. */
+#define MLFQS_HISTORY 64
+static int64_t mlfqs_epoch;			   /* Seconds since boot. */
+static int mlfqs_decay[MLFQS_HISTORY]; /* 2*load_avg / (2*load_avg + 1). */
+static struct list mlfqs_blocked[MLFQS_HISTORY];
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -66,10 +155,49 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static void cpu_init(struct cpu *, unsigned id);
+static void ready_queue_push(struct cpu *, struct thread *);
+static void ready_queue_remove(struct cpu *, struct thread *);
+static struct thread *ready_queue_pop(struct cpu *);
+static int ready_queue_max_priority(struct cpu *);
+static size_t ready_threads_cnt(void);
+static int mlfqs_priority(const struct thread *);
+static bool cfs_vruntime_less(const struct heap_elem *,
+							  const struct heap_elem *, void *aux);
+static unsigned long cfs_weight(const struct thread *);
+static void cfs_place(struct cpu *, struct thread *);
+static void cfs_account(struct cpu *, struct thread *);
+static unsigned cfs_slice(struct cpu *, struct thread *);
+static bool cfs_should_preempt(struct thread *);
+static bool edf_deadline_less(const struct heap_elem *,
+							  const struct heap_elem *, void *aux);
+static unsigned long edf_share(int64_t period, int64_t budget);
+static void edf_wakeup(struct thread *, int64_t now);
+static void edf_account(struct cpu *, struct thread *, int64_t now);
+static void edf_replenish(struct cpu *, int64_t now);
+static bool edf_should_preempt(struct thread *);
+static void mlfqs_block(struct thread *);
+static void mlfqs_wakeup(struct thread *);
+static bool held_lock_compare_priority(const struct heap_elem *,
+									   const struct heap_elem *, void *aux);
+static void thread_update_priority(struct thread *, int priority);
+static void sched_stats_switch(struct cpu *, struct thread *curr,
+							   struct thread *next);
+static void sched_stats_add(struct sched_stats *, const struct sched_stats *);
+static void fpu_init(void);
+static struct thread *thread_page_alloc(void);
+static void thread_page_free(struct thread *);
+static void reap_pages(struct work *);
+static void fpu_switch(struct cpu *, struct thread *next);
+static bool thread_wakeup_less(const struct heap_elem *,
+							   const struct heap_elem *, void *aux);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
+/* Returns true if T is some CPU's idle thread. */
+#define is_idle_thread(t) ((t)->cpu != NULL && (t)->cpu->idle_thread == (t))
+
 /* Returns the running thread.
  * Read the CPU's stack pointer `rsp', and then round that
  * down to the start of a page.  Since `struct thread' is
@@ -109,25 +237,41 @@ void thread_init(void)
 
 	/* Init the globla thread context */
 	lock_init(&tid_lock);
-	list_init(&ready_list);
+	/* Application processors are not started, so this is the
+	   only CPU the kernel will ever run on. */
+	cpu_cnt = 1;
+	cpu_init(&cpus[0], 0);
+	fpu_init();
 	list_init(&destruction_req);
+	spin_lock_init(&destruction_lock);
+	spin_lock_init(&sched_stats_lock);
+	spin_lock_init(&thread_page_lock);
+	list_init(&reap_list);
 
 	list_init(&all_list);
-	list_init(&sleep_list);
+	for (int i = 0; i < MLFQS_HISTORY; i++)
+		list_init(&mlfqs_blocked[i]);
+	heap_init(&sleep_queue, thread_wakeup_less, NULL);
+	next_wakeup = INT64_MAX;
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread();
 	init_thread(initial_thread, "main", PRI_DEFAULT);
+	initial_thread->cpu = &cpus[0];
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid();
 }
 
+/* System load average, as a fixed-point number.  Written once a
+   second by the timer interrupt, under load_avg_seq. */
 int load_avg;
+static struct seqlock load_avg_seq;
 
 /* Starts preemptive thread scheduling by enabling interrupts.
    Also creates the idle thread. */
 void thread_start(void)
 {
+	seqlock_init(&load_avg_seq);
 	load_avg = LOAD_AVG_DEFAULT;
 
 	/* Create the idle thread. */
@@ -140,6 +284,9 @@ void thread_start(void)
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down(&idle_started);
+
+	work_init(&reap_work, reap_pages, NULL);
+	workqueue_init(&reap_wq, "reaper", PRI_DEFAULT, 1, 1);
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -147,27 +294,151 @@ void thread_start(void)
 void thread_tick(void)
 {
 	struct thread *t = thread_current();
+	struct cpu *cpu = t->cpu;
+	int64_t now = timer_ticks();
 
 	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
+	seqlock_write_begin(&cpu->stats_seq);
+	if (t == cpu->idle_thread)
+		cpu->idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
-		user_ticks++;
+		cpu->user_ticks++;
 #endif
 	else
-		kernel_ticks++;
+		cpu->kernel_ticks++;
+	seqlock_write_end(&cpu->stats_seq);
+
+	if (t->edf_period != 0)
+		edf_account(cpu, t, now);
+	else if (thread_cfs && t != cpu->idle_thread)
+		cfs_account(cpu, t);
+	edf_replenish(cpu, now);
+
+	if (reap_pending)
+	{
+		reap_pending = false;
+		workqueue_queue(&reap_wq, &reap_work);
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (++cpu->thread_ticks >= cpu->time_slice)
 		intr_yield_on_return();
 }
 
-/* Prints thread statistics. */
+/* Adds CNT timer ticks that the idle thread spent halted with
+   the periodic timer stopped to the idle statistics. */
+void thread_credit_idle_ticks(int64_t cnt)
+{
+	struct cpu *cpu = this_cpu();
+
+	seqlock_write_begin(&cpu->stats_seq);
+	cpu->idle_ticks += cnt;
+	seqlock_write_end(&cpu->stats_seq);
+}
+
+/* Prints thread statistics, summed over all CPUs. */
 void thread_print_stats(void)
 {
+	long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+	long long page_cnt;
+
+	for (unsigned i = 0; i < cpu_cnt; i++)
+	{
+		struct cpu *cpu = &cpus[i];
+		long long idle, kernel, user;
+		unsigned start;
+
+		do
+		{
+			start = seqlock_read_begin(&cpu->stats_seq);
+			idle = cpu->idle_ticks;
+			kernel = cpu->kernel_ticks;
+			user = cpu->user_ticks;
+		} while (seqlock_read_retry(&cpu->stats_seq, start));
+		idle_ticks += idle;
+		kernel_ticks += kernel;
+		user_ticks += user;
+	}
 	printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 		   idle_ticks, kernel_ticks, user_ticks);
+	page_cnt = thread_page_hits + thread_page_misses;
+	printf("Thread: %lld of %lld pages from the page cache (%lld%% hit rate)\n",
+		   thread_page_hits, page_cnt,
+		   page_cnt != 0 ? thread_page_hits * 100 / page_cnt : 0);
+
+	/* Per-thread scheduler statistics of the threads still alive,
+	   then the totals including those that have exited. */
+	struct sched_stats total;
+	enum intr_level old_level = intr_disable();
+
+	spin_lock(&sched_stats_lock);
+	total = exited_sched_stats;
+	spin_unlock(&sched_stats_lock);
+	for (struct list_elem *e = list_begin(&all_list); e != list_end(&all_list);
+		 e = list_next(e))
+	{
+		struct thread *t = list_entry(e, struct thread, allelem);
+		struct sched_stats *st = &t->sched_stats;
+
+		printf("Thread %s (tid %d): %llu cycles running, %llu cycles waiting, "
+			   "%llu voluntary, %llu involuntary switches\n",
+			   t->name, t->tid, st->run_time, st->wait_time,
+			   st->voluntary_switches, st->involuntary_switches);
+		sched_stats_add(&total, st);
+	}
+	intr_set_level(old_level);
+
+	printf("Scheduler: %llu cycles running, %llu cycles waiting, "
+		   "%llu voluntary, %llu involuntary switches\n",
+		   total.run_time, total.wait_time,
+		   total.voluntary_switches, total.involuntary_switches);
+	for (int i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+		if (total.latency[i] != 0)
+			printf("Scheduler: %u wakeups ran after 2^%d cycles\n",
+				   total.latency[i], i);
+}
+
+/* Copies the scheduler statistics of the thread with the given
+   TID into STATS, or those of the running thread if TID is 0.
+   Time spent in the current run or wait is included.  Returns
+   false if there is no such thread. */
+bool thread_get_sched_stats(tid_t tid, struct sched_stats *stats)
+{
+	struct thread *cur = thread_current();
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable();
+	if (tid == 0 || tid == cur->tid)
+		t = cur;
+	else
+		for (struct list_elem *e = list_begin(&all_list); e != list_end(&all_list);
+			 e = list_next(e))
+			if (list_entry(e, struct thread, allelem)->tid == tid)
+			{
+				t = list_entry(e, struct thread, allelem);
+				break;
+			}
+
+	if (t != NULL)
+	{
+		*stats = t->sched_stats;
+		if (t == cur)
+			stats->run_time += rdtsc() - t->run_since;
+		else if (t->status == THREAD_READY)
+			stats->wait_time += rdtsc() - t->ready_since;
+	}
+	intr_set_level(old_level);
+
+	return t != NULL;
+}
+
+/* Returns the CPU the caller is running on. */
+struct cpu *
+this_cpu(void)
+{
+	return running_thread()->cpu;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -187,9 +458,19 @@ void thread_print_stats(void)
    Priority scheduling is the goal of Problem 1-3. */
 void thread_test_preemption(void)
 {
-	if (!list_empty(&ready_list) &&
-		thread_current()->priority <
-			list_entry(list_front(&ready_list), struct thread, elem)->priority)
+	struct thread *cur = thread_current();
+	bool preempt;
+
+	/* EDF threads run before all others. */
+	if (edf_should_preempt(cur))
+		preempt = true;
+	else if (cur->edf_period != 0)
+		preempt = false;
+	else
+		preempt = thread_cfs ? cfs_should_preempt(cur)
+							 : cur->priority < ready_queue_max_priority(cur->cpu);
+
+	if (preempt)
 	{
 		/** Project 2: Panic 방지 */
 		if (intr_context())
@@ -208,12 +489,17 @@ tid_t thread_create(const char *name, int priority,
 	ASSERT(function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page(PAL_ZERO);
+	t = thread_page_alloc();
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread(t, name, priority);
+	t->cpu = this_cpu();
+	t->vruntime = t->cpu->min_vruntime;
+	/* The MLFQS ignores the requested priority. */
+	if (thread_mlfqs && function != idle)
+		t->priority = mlfqs_priority(t);
 	tid = t->tid = allocate_tid();
 
 #ifdef USERPROG
@@ -250,11 +536,11 @@ tid_t thread_create(const char *name, int priority,
 	thread_unblock(t);
 
 	// 1. 새로 생성된 스레드의 우선순위가 실행중이던 스레드보다 높을 경우
-	// 1-1. 현재 실행중이던 스레드를 대기상태로 전환 -> yeild, ready_list에 현재 실행중인 프로세스 삽입
+	// 1-1. 현재 실행중이던 스레드를 대기상태로 전환 -> yeild, ready_queue에 현재 실행중인 프로세스 삽입
 	// 1-2. 새로 만든 프로세스를 실행 -> schedule 함수 호출하여 더 높은 우선순위를 가진 프로세스를 실행하도록
 	thread_test_preemption();
 	// 2. 새로 생성된 스레드의 우선순위가 실행중이던 스레드보다 낮거나 같을 경우
-	// 새로 생성된 스레드를 ready_list에 삽입하였으므로 그대로 종료
+	// 새로 생성된 스레드를 ready_queue에 삽입하였으므로 그대로 종료
 
 	return tid;
 }
@@ -270,16 +556,11 @@ void thread_block(void)
 	ASSERT(!intr_context());
 	ASSERT(intr_get_level() == INTR_OFF);
 	thread_current()->status = THREAD_BLOCKED;
+	if (thread_mlfqs && !is_idle_thread(thread_current()))
+		mlfqs_block(thread_current());
 	schedule();
 }
 
-bool thread_priority_compare(const struct list_elem *a, const struct list_elem *b, void *aux)
-{
-	const struct thread *t_a = list_entry(a, struct thread, elem);
-	const struct thread *t_b = list_entry(b, struct thread, elem);
-	return t_a->priority > t_b->priority; // 높은 우선순위가 앞에 오도록 정렬
-}
-
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -296,9 +577,16 @@ void thread_unblock(struct thread *t)
 
 	old_level = intr_disable();
 	ASSERT(t->status == THREAD_BLOCKED);
-	// list_push_back (&ready_list, &t->elem);
-	list_insert_ordered(&ready_list, &t->elem, thread_priority_compare, NULL);
+	if (thread_mlfqs)
+		mlfqs_wakeup(t);
+	if (t->edf_period != 0)
+		edf_wakeup(t, timer_ticks());
+	else if (thread_cfs)
+		cfs_place(t->cpu, t);
+	ready_queue_push(t->cpu, t);
 	t->status = THREAD_READY;
+	t->ready_since = rdtsc();
+	t->woken = true;
 	intr_set_level(old_level);
 }
 
@@ -343,10 +631,14 @@ void thread_exit(void)
 #ifdef USERPROG
 	process_exit();
 #endif
+	thread_fpu_release();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable();
+	if (thread_current()->edf_period != 0)
+		edf_utilization -= edf_share(thread_current()->edf_period,
+									 thread_current()->edf_budget);
 	list_remove(&thread_current()->allelem);
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
@@ -362,10 +654,8 @@ void thread_yield(void)
 	ASSERT(!intr_context());
 
 	old_level = intr_disable();
-	if (curr != idle_thread)
-		// list_push_back (&ready_list, &curr->elem);
-		// 뒤에 삽입하는 것이 아닌 우선순위를 비교하고 맞는 위치에 삽입
-		list_insert_ordered(&ready_list, &curr->elem, thread_priority_compare, NULL);
+	if (curr != curr->cpu->idle_thread)
+		ready_queue_push(curr->cpu, curr);
 
 	do_schedule(THREAD_READY);
 	intr_set_level(old_level);
@@ -377,9 +667,11 @@ void thread_set_priority(int new_priority)
 	if (thread_mlfqs)
 		return;
 
+	enum intr_level old_level = intr_disable();
 	thread_current()->init_priority = new_priority;
+	refresh_priority(thread_current());
+	intr_set_level(old_level);
 
-	refresh_priority();
 	thread_test_preemption();
 }
 
@@ -394,7 +686,8 @@ void thread_set_nice(int nice UNUSED)
 { // 현재 스레드의 nice 값을 새 값으로 설정
 	enum intr_level old_level = intr_disable();
 	thread_current()->nice = nice;
-	mlfqs_calculate_priority(thread_current());
+	if (thread_mlfqs)
+		mlfqs_calculate_priority(thread_current());
 	thread_test_preemption();
 	intr_set_level(old_level);
 }
@@ -409,10 +702,15 @@ int thread_get_nice(void)
 
 int thread_get_load_avg(void)
 { // 현재 시스템의 load_avg * 100 값을 반환
-	enum intr_level old_level = intr_disable();
-	int load_avg_value = fp_to_int_round(mult_mixed(load_avg, 100));
-	intr_set_level(old_level);
-	return load_avg_value;
+	unsigned start;
+	int value;
+
+	do
+	{
+		start = seqlock_read_begin(&load_avg_seq);
+		value = load_avg;
+	} while (seqlock_read_retry(&load_avg_seq, start));
+	return fp_to_int_round(mult_mixed(value, 100));
 }
 
 int thread_get_recent_cpu(void)
@@ -437,15 +735,26 @@ idle(void *idle_started_ UNUSED)
 {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current();
+	this_cpu()->idle_thread = thread_current();
 	sema_up(idle_started);
 
 	for (;;)
 	{
+		/* Zero free pages for the page allocator until another
+		   thread is ready.  The time is charged to no thread, so it
+		   leaves load_avg and recent_cpu alone. */
+		while (this_cpu()->ready_cnt == 0 && palloc_zero_idle())
+			continue;
+
 		/* Let someone else run. */
 		intr_disable();
 		thread_block();
 
+		/* Nothing else can run until some interrupt arrives, so
+		   in tickless mode let the timer skip the ticks until
+		   the next sleeper is due. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -491,10 +800,14 @@ init_thread(struct thread *t, const char *name, int priority)
 	// 구조체에 새로 선언한 변수들 초기화
 	t->init_priority = priority;
 	t->wait_on_lock = NULL;
-	list_init(&t->donations);
+	heap_init(&t->held_locks, held_lock_compare_priority, NULL);
 
 	t->nice = NICE_DEFAULT;
 	t->recent_cpu = RECENT_CPU_DEFAULT;
+	t->mlfqs_epoch = mlfqs_epoch;
+	t->mlfqs_blocked = false;
+
+	t->ready_since = t->run_since = rdtsc();
 
 	t->magic = THREAD_MAGIC;
 
@@ -510,6 +823,11 @@ init_thread(struct thread *t, const char *name, int priority)
 	sema_init(&t->exit_sema, 0);
 	sema_init(&t->wait_sema, 0);
 	/** -----------------------  */
+
+	t->leader = t;
+	lock_init(&t->proc_lock);
+	list_init(&t->members);
+	t->stack_map = 1; /* Slot 0 is the stack set up by load(). */
 #endif
 }
 
@@ -521,10 +839,176 @@ init_thread(struct thread *t, const char *name, int priority)
 static struct thread *
 next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
-		return idle_thread;
+	struct cpu *cpu = this_cpu();
+	struct thread *next = ready_queue_pop(cpu);
+
+	return next != NULL ? next : cpu->idle_thread;
+}
+
+/* Initializes CPU as the CPU numbered ID, with an empty run
+   queue.  Its idle thread is filled in once it starts. */
+static void
+cpu_init(struct cpu *cpu, unsigned id)
+{
+	memset(cpu, 0, sizeof *cpu);
+	cpu->id = id;
+	spin_lock_init(&cpu->rq_lock);
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init(&cpu->ready_queue[i]);
+	heap_init(&cpu->cfs_queue, cfs_vruntime_less, NULL);
+	heap_init(&cpu->edf_queue, edf_deadline_less, NULL);
+	heap_init(&cpu->edf_throttled, edf_deadline_less, NULL);
+	seqlock_init(&cpu->stats_seq);
+	cpu->time_slice = TIME_SLICE;
+}
+
+/* Appends T to the tail of CPU's run queue for T's current
+   priority.  An EDF thread goes into the EDF queue instead, or if
+   it has no budget left, among the throttled threads. */
+static void
+ready_queue_push(struct cpu *cpu, struct thread *t)
+{
+	ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	spin_lock(&cpu->rq_lock);
+	if (t->edf_period != 0 && t->edf_remaining <= 0)
+	{
+		heap_push(&cpu->edf_throttled, &t->edf_elem);
+		t->cpu = cpu;
+		spin_unlock(&cpu->rq_lock);
+		return;
+	}
+	if (t->edf_period != 0)
+		heap_push(&cpu->edf_queue, &t->edf_elem);
+	else if (thread_cfs)
+	{
+		heap_push(&cpu->cfs_queue, &t->cfs_elem);
+		cpu->cfs_load += cfs_weight(t);
+	}
 	else
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
+	{
+		list_push_back(&cpu->ready_queue[t->priority], &t->elem);
+		cpu->ready_mask |= 1ULL << t->priority;
+	}
+	cpu->ready_cnt++;
+	t->cpu = cpu;
+	spin_unlock(&cpu->rq_lock);
+}
+
+/* Removes T, which must be in CPU's run queue for T's current
+   priority, from the run queue. */
+static void
+ready_queue_remove(struct cpu *cpu, struct thread *t)
+{
+	ASSERT(t->status == THREAD_READY);
+
+	spin_lock(&cpu->rq_lock);
+	if (t->edf_period != 0 && t->edf_remaining <= 0)
+	{
+		heap_remove(&cpu->edf_throttled, &t->edf_elem);
+		spin_unlock(&cpu->rq_lock);
+		return;
+	}
+	if (t->edf_period != 0)
+		heap_remove(&cpu->edf_queue, &t->edf_elem);
+	else if (thread_cfs)
+	{
+		heap_remove(&cpu->cfs_queue, &t->cfs_elem);
+		cpu->cfs_load -= cfs_weight(t);
+	}
+	else
+	{
+		list_remove(&t->elem);
+		if (list_empty(&cpu->ready_queue[t->priority]))
+			cpu->ready_mask &= ~(1ULL << t->priority);
+	}
+	cpu->ready_cnt--;
+	spin_unlock(&cpu->rq_lock);
+}
+
+/* Removes and returns the EDF thread with the earliest deadline
+   in CPU's run queue, if any, and otherwise the oldest thread of
+   the highest priority, or under "-cfs" the thread with the least
+   vruntime, or a null pointer if the run queue is empty. */
+static struct thread *
+ready_queue_pop(struct cpu *cpu)
+{
+	struct thread *t = NULL;
+	int priority;
+
+	spin_lock(&cpu->rq_lock);
+	priority = ready_queue_max_priority(cpu);
+	if (!heap_empty(&cpu->edf_queue))
+	{
+		t = heap_entry(heap_pop(&cpu->edf_queue), struct thread, edf_elem);
+		cpu->ready_cnt--;
+	}
+	else if (thread_cfs)
+	{
+		if (!heap_empty(&cpu->cfs_queue))
+		{
+			t = heap_entry(heap_pop(&cpu->cfs_queue), struct thread, cfs_elem);
+			cpu->cfs_load -= cfs_weight(t);
+			cpu->ready_cnt--;
+		}
+	}
+	else if (priority >= PRI_MIN)
+	{
+		struct list *queue = &cpu->ready_queue[priority];
+
+		t = list_entry(list_pop_front(queue), struct thread, elem);
+		if (list_empty(queue))
+			cpu->ready_mask &= ~(1ULL << priority);
+		cpu->ready_cnt--;
+	}
+	spin_unlock(&cpu->rq_lock);
+	return t;
+}
+
+/* Returns the highest priority in CPU's run queue, or
+   PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_queue_max_priority(struct cpu *cpu)
+{
+	uint64_t mask = cpu->ready_mask;
+
+	if (mask == 0)
+		return PRI_MIN - 1;
+	return 63 - __builtin_clzll(mask);
+}
+
+/* Returns the number of threads in all CPUs' run queues. */
+static size_t
+ready_threads_cnt(void)
+{
+	size_t cnt = 0;
+
+	for (unsigned i = 0; i < cpu_cnt; i++)
+		cnt += cpus[i].ready_cnt;
+	return cnt;
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is waiting in
+   the run queue, it is moved to the tail of the new priority's
+   list so that the run queue stays consistent.  (The CFS run
+   queue does not depend on priority.) */
+static void
+thread_update_priority(struct thread *t, int priority)
+{
+	enum intr_level old_level = intr_disable();
+
+	if (t->status == THREAD_READY && t->priority != priority && !thread_cfs)
+	{
+		ready_queue_remove(t->cpu, t);
+		t->priority = priority;
+		ready_queue_push(t->cpu, t);
+	}
+	else if (t->priority != priority)
+	{
+		t->priority = priority;
+		sema_waiter_update(t);
+	}
+	intr_set_level(old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -569,7 +1053,7 @@ static void
 thread_launch(struct thread *th)
 {
 	uint64_t tf_cur = (uint64_t)&running_thread()->tf;
-	uint64_t tf = (uint64_t)&th->tf;
+	uint64_t next = (uint64_t)th;
 	ASSERT(intr_get_level() == INTR_OFF);
 
 	/* The main switching logic.
@@ -619,9 +1103,27 @@ thread_launch(struct thread *th)
 		"mov %%rsp, 24(%%rax)\n" // rsp
 		"movw %%ss, 32(%%rax)\n"
 		"mov %%rcx, %%rdi\n"
-		"call do_iret\n"
+		"call thread_resume\n"
 		"out_iret:\n"
-		: : "g"(tf_cur), "g"(tf) : "memory");
+		: : "g"(tf_cur), "g"(next) : "memory");
+}
+
+/* Resumes NEXT where it left the CPU: through switch_resume() if
+   it was suspended in switch_threads(), otherwise from its
+   intr_frame, which holds either the context thread_launch()
+   saved or, for a thread that never ran, the entry point set up
+   by thread_create(). */
+void thread_resume(struct thread *next)
+{
+	uint64_t rsp = next->switch_rsp;
+
+	if (rsp != 0)
+	{
+		next->switch_rsp = 0;
+		switch_resume(rsp);
+	}
+	do_iret(&next->tf);
+	NOT_REACHED();
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -633,11 +1135,17 @@ do_schedule(int status)
 {
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(thread_current()->status == THREAD_RUNNING);
-	while (!list_empty(&destruction_req))
+	for (;;)
 	{
-		struct thread *victim =
-			list_entry(list_pop_front(&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		struct thread *victim = NULL;
+
+		spin_lock(&destruction_lock);
+		if (!list_empty(&destruction_req))
+			victim = list_entry(list_pop_front(&destruction_req), struct thread, elem);
+		spin_unlock(&destruction_lock);
+		if (victim == NULL)
+			break;
+		thread_page_free(victim);
 	}
 	thread_current()->status = status;
 	schedule();
@@ -647,16 +1155,27 @@ static void
 schedule(void)
 {
 	struct thread *curr = running_thread();
+	struct cpu *cpu = curr->cpu;
 	struct thread *next = next_thread_to_run();
 
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(curr->status != THREAD_RUNNING);
 	ASSERT(is_thread(next));
-	/* Mark us as running. */
+	/* Leaving the idle thread ends any stretched timer period. */
+	if (curr == cpu->idle_thread && next != cpu->idle_thread)
+		timer_idle_exit();
+
+	/* Mark us as running, on this CPU. */
 	next->status = THREAD_RUNNING;
+	next->cpu = cpu;
+	fpu_switch(cpu, next);
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	cpu->thread_ticks = 0;
+	if (next->edf_period != 0)
+		cpu->time_slice = next->edf_remaining;
+	else
+		cpu->time_slice = thread_cfs ? cfs_slice(cpu, next) : TIME_SLICE;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -665,6 +1184,8 @@ schedule(void)
 
 	if (curr != next)
 	{
+		sched_stats_switch(cpu, curr, next);
+
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -675,12 +1196,80 @@ schedule(void)
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread)
 		{
 			ASSERT(curr != next);
+			spin_lock(&destruction_lock);
 			list_push_back(&destruction_req, &curr->elem);
+			spin_unlock(&destruction_lock);
 		}
 
 		/* Before switching the thread, we first save the information
 		 * of current running. */
-		thread_launch(next);
+		if (thread_iret_switch)
+			thread_launch(next);
+		else
+			switch_threads(&curr->switch_rsp, next);
+	}
+}
+
+/* Returns a page for a new thread, from the page cache if it is
+   not empty, or else from the pages waiting for the reaper.
+   Only the `struct thread' at the bottom of the page is cleared,
+   by init_thread(); the stack is left as it is. */
+static struct thread *
+thread_page_alloc(void)
+{
+	struct thread *t = NULL;
+
+	spin_lock(&thread_page_lock);
+	if (thread_page_cache_cnt > 0)
+	{
+		t = thread_page_cache[--thread_page_cache_cnt];
+		thread_page_hits++;
+	}
+	else if (!list_empty(&reap_list))
+	{
+		t = list_entry(list_pop_front(&reap_list), struct thread, elem);
+		thread_page_hits++;
+	}
+	else
+		thread_page_misses++;
+	spin_unlock(&thread_page_lock);
+
+	return t != NULL ? t : palloc_get_page(0);
+}
+
+/* Frees the page of destroyed thread T, keeping it in the page
+   cache if there is room and otherwise leaving it to the reaper.
+   Called by the scheduler. */
+static void
+thread_page_free(struct thread *t)
+{
+	spin_lock(&thread_page_lock);
+	if (thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX)
+		thread_page_cache[thread_page_cache_cnt++] = t;
+	else
+	{
+		list_push_back(&reap_list, &t->elem);
+		reap_pending = true;
+	}
+	spin_unlock(&thread_page_lock);
+}
+
+/* Work function of reap_work.  Gives the pages on reap_list back
+   to the page allocator, out of the scheduler's way. */
+static void
+reap_pages(struct work *w UNUSED)
+{
+	for (;;)
+	{
+		struct thread *t = NULL;
+
+		spin_lock(&thread_page_lock);
+		if (!list_empty(&reap_list))
+			t = list_entry(list_pop_front(&reap_list), struct thread, elem);
+		spin_unlock(&thread_page_lock);
+		if (t == NULL)
+			break;
+		palloc_free_page(t);
 	}
 }
 
@@ -698,6 +1287,62 @@ allocate_tid(void)
 	return tid;
 }
 
+/* Accounts the switch from CURR to NEXT on CPU in both threads'
+   scheduler statistics.  CURR already has its new status: it is
+   switched out involuntarily if it is still ready to run. */
+static void
+sched_stats_switch(struct cpu *cpu, struct thread *curr, struct thread *next)
+{
+	uint64_t now = rdtsc();
+
+	curr->sched_stats.run_time += now - curr->run_since;
+	if (curr->status == THREAD_READY)
+	{
+		curr->sched_stats.involuntary_switches++;
+		curr->ready_since = now;
+		curr->woken = false;
+	}
+	else
+		curr->sched_stats.voluntary_switches++;
+
+	if (curr->status == THREAD_DYING)
+	{
+		spin_lock(&sched_stats_lock);
+		sched_stats_add(&exited_sched_stats, &curr->sched_stats);
+		spin_unlock(&sched_stats_lock);
+	}
+
+	/* The idle thread is never queued, so it never waits. */
+	if (next != cpu->idle_thread)
+	{
+		uint64_t wait = now - next->ready_since;
+
+		next->sched_stats.wait_time += wait;
+		if (next->woken)
+		{
+			int bucket = wait != 0 ? 63 - __builtin_clzll(wait) : 0;
+
+			if (bucket >= SCHED_LATENCY_BUCKETS)
+				bucket = SCHED_LATENCY_BUCKETS - 1;
+			next->sched_stats.latency[bucket]++;
+			next->woken = false;
+		}
+	}
+	next->run_since = now;
+}
+
+/* Adds the scheduler statistics in SRC to DST. */
+static void
+sched_stats_add(struct sched_stats *dst, const struct sched_stats *src)
+{
+	dst->run_time += src->run_time;
+	dst->wait_time += src->wait_time;
+	dst->voluntary_switches += src->voluntary_switches;
+	dst->involuntary_switches += src->involuntary_switches;
+	for (int i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+		dst->latency[i] += src->latency[i];
+}
+
 void thread_sleep(int64_t ticks)
 {
 	struct thread *cur;
@@ -706,143 +1351,863 @@ void thread_sleep(int64_t ticks)
 	old_level = intr_disable(); // 인터럽트 off
 	cur = thread_current();
 
-	ASSERT(cur != idle_thread);
+	ASSERT(cur != cur->cpu->idle_thread);
 
-	cur->wakeup = ticks;					 // 일어날 시간을 저장
-	list_push_back(&sleep_list, &cur->elem); // sleep_list 에 추가
-	thread_block();							 // block 상태로 변경
+	thread_timeout_start(ticks);
+	thread_block(); // block 상태로 변경
 
 	intr_set_level(old_level); // 인터럽트 on
 }
 
+/* Puts the running thread in the sleep queue without blocking
+   it, so that thread_awake() unblocks it at tick TICKS if it is
+   blocked then, after taking it off the semaphore it waits for,
+   if any.  The thread must call thread_timeout_cancel() once it
+   stops waiting, whether or not the timeout expired.
+   Interrupts must be off. */
+void thread_timeout_start(int64_t ticks)
+{
+	struct thread *cur = thread_current();
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(!cur->sleeping);
+
+	cur->wakeup = ticks;						  // 일어날 시간을 저장
+	cur->sleeping = true;
+	heap_push(&sleep_queue, &cur->sleep_elem); // sleep_queue 에 추가
+	if (ticks < next_wakeup)
+		next_wakeup = ticks;
+}
+
+/* Returns true if the running thread's timeout, started with
+   thread_timeout_start(), has expired.  Interrupts must be off. */
+bool thread_timeout_expired(void)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	return !thread_current()->sleeping;
+}
+
+/* Takes the running thread out of the sleep queue, if its
+   timeout has not expired yet.  Interrupts must be off. */
+void thread_timeout_cancel(void)
+{
+	struct thread *cur = thread_current();
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (cur->sleeping)
+	{
+		heap_remove(&sleep_queue, &cur->sleep_elem);
+		cur->sleeping = false;
+	}
+}
+
+/* Wakes up every sleeping thread whose wakeup tick is at or
+   before TICKS.  Called from the timer interrupt, so it returns
+   immediately unless the earliest deadline has expired. */
 void thread_awake(int64_t ticks)
 {
-	struct list_elem *e = list_begin(&sleep_list);
+	if (ticks < next_wakeup)
+		return;
 
-	while (e != list_end(&sleep_list))
+	while (!heap_empty(&sleep_queue))
 	{
-		struct thread *t = list_entry(e, struct thread, elem);
-		if (t->wakeup <= ticks)
-		{						// 스레드가 일어날 시간이 되었는지 확인
-			e = list_remove(e); // sleep list 에서 제거
-			thread_unblock(t);	// 스레드 unblock
+		struct thread *t = heap_entry(heap_top(&sleep_queue), struct thread, sleep_elem);
+		if (t->wakeup > ticks) // 가장 이른 스레드도 아직 일어날 시간이 아님
+			break;
+		heap_pop(&sleep_queue); // sleep queue 에서 제거
+		t->sleeping = false;
+
+		/* A thread whose wait ended before its timeout is already
+		   ready, and only has to be taken out of the queue. */
+		if (t->status == THREAD_BLOCKED)
+		{
+			sema_waiter_cancel(t);
+			thread_unblock(t); // 스레드 unblock
 		}
-		else
-			e = list_next(e);
 	}
+
+	next_wakeup = heap_empty(&sleep_queue)
+					  ? INT64_MAX
+					  : heap_entry(heap_top(&sleep_queue), struct thread, sleep_elem)->wakeup;
+
+	/* A woken EDF thread must not wait for the end of the running
+	   thread's time slice, and neither must a CFS sleeper that is
+	   far enough behind the running thread. */
+	if (edf_should_preempt(thread_current()))
+		intr_yield_on_return();
+	else if (thread_cfs && thread_current()->edf_period == 0 && cfs_should_preempt(thread_current()))
+		intr_yield_on_return();
+}
+
+/* Returns the earliest tick at which a sleeping thread is due to
+   wake up or a throttled EDF thread is due to get its budget
+   back, or INT64_MAX if there is no such thread. */
+int64_t thread_next_wakeup(void)
+{
+	int64_t wakeup = next_wakeup;
+
+	for (unsigned i = 0; i < cpu_cnt; i++)
+	{
+		struct heap_elem *e = heap_top(&cpus[i].edf_throttled);
+
+		if (e != NULL && heap_entry(e, struct thread, edf_elem)->edf_deadline < wakeup)
+			wakeup = heap_entry(e, struct thread, edf_elem)->edf_deadline;
+	}
+	return wakeup;
+}
+
+/* Orders the sleep queue by wakeup tick, earliest first. */
+static bool
+thread_wakeup_less(const struct heap_elem *a, const struct heap_elem *b,
+				   void *aux UNUSED)
+{
+	return heap_entry(a, struct thread, sleep_elem)->wakeup <
+		   heap_entry(b, struct thread, sleep_elem)->wakeup;
+}
+
+/* Priority donation.
+
+   Each lock keeps the threads waiting for it in `donors', a heap
+   with the highest priority on top, and each thread keeps the
+   locks it holds in `held_locks', a heap ordered by the top donor
+   of each lock.  A thread's effective priority is then its own
+   priority or the top of its top held lock, whichever is higher,
+   and raising or lowering it only has to walk the chain of
+   wait_on_lock holders while something actually changes.
+
+   A reader-writer lock has many holders while it is read, so a
+   writer waiting for them cannot use wait_on_lock.  It sets
+   wait_on_rwlock instead, and lends its priority to each thread
+   in the rwlock's `holders', which count it among their own
+   donors through their read_holds.  All of this runs with
+   interrupts off. */
+
+/* Returns the highest priority among the threads waiting for
+   LOCK, or PRI_MIN - 1 if there are none. */
+static int
+lock_donated_priority(const struct lock *lock)
+{
+	struct heap_elem *e = heap_top(&lock->donors);
+
+	return e != NULL ? heap_entry(e, struct thread, donation_elem)->priority : PRI_MIN - 1;
+}
+
+/* Orders a lock's donors by priority, highest first. */
+bool thread_compare_donate_priority(const struct heap_elem *l,
+									const struct heap_elem *s, void *aux UNUSED)
+{
+	return heap_entry(l, struct thread, donation_elem)->priority > heap_entry(s, struct thread, donation_elem)->priority;
 }
 
-//
-bool thread_compare_donate_priority(const struct list_elem *l,
-									const struct list_elem *s, void *aux UNUSED)
+/* Orders a thread's held locks by the priority they donate,
+   highest first. */
+static bool
+held_lock_compare_priority(const struct heap_elem *l,
+						   const struct heap_elem *s, void *aux UNUSED)
 {
-	return list_entry(l, struct thread, donation_elem)->priority > list_entry(s, struct thread, donation_elem)->priority;
+	return lock_donated_priority(heap_entry(l, struct lock, held_elem)) >
+		   lock_donated_priority(heap_entry(s, struct lock, held_elem));
 }
 
-void donate_priority(void)
+/* The running thread is about to wait for LOCK.  Registers it as
+   one of LOCK's donors and passes its priority on to the holder,
+   and from there along the whole chain of lock holders. */
+void donate_priority(struct lock *lock)
 {
-	int depth;
 	struct thread *cur = thread_current();
 
-	for (depth = 0; depth < 8; depth++)
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(cur->wait_on_lock == NULL);
+
+	cur->wait_on_lock = lock;
+	heap_push(&lock->donors, &cur->donation_elem);
+	if (lock->holder != NULL)
 	{
-		if (!cur->wait_on_lock)
-			break;
-		struct thread *holder = cur->wait_on_lock->holder;
-		holder->priority = cur->priority;
-		cur = holder;
+		heap_update(&lock->holder->held_locks, &lock->held_elem);
+		refresh_priority(lock->holder);
 	}
 }
 
-void remove_with_lock(struct lock *lock)
+/* The running thread has given up waiting for LOCK.  It stops
+   being one of LOCK's donors, and the priority it lent to the
+   holder, and along the chain of holders from there, is taken
+   back. */
+void cancel_donation(struct lock *lock)
 {
-	struct list_elem *e;
 	struct thread *cur = thread_current();
 
-	for (e = list_begin(&cur->donations); e != list_end(&cur->donations); e = list_next(e))
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(cur->wait_on_lock == lock);
+
+	heap_remove(&lock->donors, &cur->donation_elem);
+	cur->wait_on_lock = NULL;
+	if (lock->holder != NULL)
 	{
-		struct thread *t = list_entry(e, struct thread, donation_elem);
-		if (t->wait_on_lock == lock)
-			list_remove(&t->donation_elem);
+		heap_update(&lock->holder->held_locks, &lock->held_elem);
+		refresh_priority(lock->holder);
 	}
 }
 
-void refresh_priority(void)
+/* The running thread has just acquired LOCK.  It stops being one
+   of LOCK's donors, if it was waiting, and instead receives the
+   donations of the threads still waiting. */
+void receive_donation(struct lock *lock)
 {
 	struct thread *cur = thread_current();
 
-	cur->priority = cur->init_priority;
+	ASSERT(intr_get_level() == INTR_OFF);
 
-	if (!list_empty(&cur->donations))
+	if (cur->wait_on_lock == lock)
 	{
-		list_sort(&cur->donations, thread_compare_donate_priority, 0);
+		heap_remove(&lock->donors, &cur->donation_elem);
+		cur->wait_on_lock = NULL;
+	}
+	lock->holder = cur;
+	heap_push(&cur->held_locks, &lock->held_elem);
+	refresh_priority(cur);
+}
 
-		struct thread *front = list_entry(list_front(&cur->donations), struct thread, donation_elem);
-		if (front->priority > cur->priority)
-			cur->priority = front->priority;
+/* The running thread is releasing LOCK, and with it the
+   donations of LOCK's waiters. */
+void remove_with_lock(struct lock *lock)
+{
+	struct thread *cur = thread_current();
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	heap_remove(&cur->held_locks, &lock->held_elem);
+	refresh_priority(cur);
+}
+
+/* Passes the priority of the writer waiting for RWLOCK's readers
+   on to each of them, and along the chains of lock holders from
+   there. */
+void donate_to_readers(struct rwlock *rwlock)
+{
+	struct list_elem *e;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (e = list_begin(&rwlock->holders); e != list_end(&rwlock->holders);
+		 e = list_next(e))
+		refresh_priority(list_entry(e, struct rwlock_hold, elem)->thread);
+}
+
+/* Recomputes T's effective priority from its own priority, the
+   locks it holds and the writers waiting for the reader-writer
+   locks it holds to read.  If that changes it, T's position
+   among the donors of the lock it waits for changes too, so the
+   lock's holder is recomputed in turn, to any depth, stopping as
+   soon as a priority stays the same. */
+void refresh_priority(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (;;)
+	{
+		int priority = t->init_priority;
+		struct heap_elem *top = heap_top(&t->held_locks);
+		struct lock *lock;
+		int i;
+
+		if (top != NULL)
+		{
+			int donated = lock_donated_priority(heap_entry(top, struct lock, held_elem));
+			if (donated > priority)
+				priority = donated;
+		}
+		for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+		{
+			struct rwlock *rwlock = t->read_holds[i].rwlock;
+
+			if (rwlock != NULL && rwlock->writer != NULL && rwlock->writer->priority > priority)
+				priority = rwlock->writer->priority;
+		}
+		if (priority == t->priority)
+			return;
+		thread_update_priority(t, priority);
+
+		if (t->wait_on_rwlock != NULL)
+		{
+			donate_to_readers(t->wait_on_rwlock);
+			return;
+		}
+		lock = t->wait_on_lock;
+		if (lock == NULL)
+			return;
+		heap_update(&lock->donors, &t->donation_elem);
+		if (lock->holder == NULL)
+			return;
+		heap_update(&lock->holder->held_locks, &lock->held_elem);
+		t = lock->holder;
 	}
 }
 
 /**  Project 1: MLFQS **/
-void mlfqs_calculate_priority(struct thread *t)
+
+/* Returns the priority T should have under the MLFQS. */
+static int
+mlfqs_priority(const struct thread *t)
 {
-	if (t == idle_thread)
-		return;
-	t->priority = fp_to_int(add_mixed(div_mixed(t->recent_cpu, -4), PRI_MAX - t->nice * 2));
+	int priority = fp_to_int(add_mixed(div_mixed(t->recent_cpu, -4), PRI_MAX - t->nice * 2));
+
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	else if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	return priority;
+}
+
+/* Applies to T's recent_cpu every once-a-second decay it missed
+   since its last update, replaying each second's factor from the
+   history.  mlfqs_blocked[] guarantees they are all still there. */
+static void
+mlfqs_catch_up(struct thread *t)
+{
+	int64_t missed = mlfqs_epoch - t->mlfqs_epoch;
+
+	ASSERT(missed >= 0 && missed < MLFQS_HISTORY);
+
+	for (int64_t e = mlfqs_epoch - missed + 1; e <= mlfqs_epoch; e++)
+		t->recent_cpu = add_mixed(mult_fp(mlfqs_decay[e % MLFQS_HISTORY], t->recent_cpu), t->nice);
+	t->mlfqs_epoch = mlfqs_epoch;
+}
+
+/* Files T, which is blocking, under the second it was last
+   decayed at.  T is up to date, since it was running. */
+static void
+mlfqs_block(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	list_push_back(&mlfqs_blocked[t->mlfqs_epoch % MLFQS_HISTORY], &t->mlfqs_elem);
+	t->mlfqs_blocked = true;
 }
 
-void mlfqs_calculate_recent_cpu(struct thread *t)
+/* Takes T, which is about to be put on a run queue, out of
+   mlfqs_blocked[] and brings its recent_cpu and priority up to
+   date.  The priority of a blocked thread is left alone even when
+   its recent_cpu is caught up early, because it may order a
+   waiters heap. */
+static void
+mlfqs_wakeup(struct thread *t)
 {
-	if (t == idle_thread)
+	ASSERT(t->status == THREAD_BLOCKED);
+
+	if (t->mlfqs_blocked)
+	{
+		list_remove(&t->mlfqs_elem);
+		t->mlfqs_blocked = false;
+	}
+	if (t->mlfqs_epoch != mlfqs_epoch)
+		mlfqs_catch_up(t);
+	t->priority = mlfqs_priority(t);
+}
+
+void mlfqs_calculate_priority(struct thread *t)
+{
+	if (is_idle_thread(t))
 		return;
-	t->recent_cpu = add_mixed(mult_fp(div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1)), t->recent_cpu), t->nice);
+	thread_update_priority(t, mlfqs_priority(t));
 }
 
 void mlfqs_calculate_load_avg(void)
 {
 	int ready_threads;
 
-	if (thread_current() == idle_thread)
-		ready_threads = list_size(&ready_list);
+	if (is_idle_thread(thread_current()))
+		ready_threads = ready_threads_cnt();
 	else
-		ready_threads = list_size(&ready_list) + 1;
+		ready_threads = ready_threads_cnt() + 1;
 
+	seqlock_write_begin(&load_avg_seq);
 	load_avg = add_fp(mult_fp(div_fp(int_to_fp(59), int_to_fp(60)), load_avg),
 					  mult_mixed(div_fp(int_to_fp(1), int_to_fp(60)), ready_threads));
+	seqlock_write_end(&load_avg_seq);
 }
 
 void mlfqs_increment_recent_cpu(void)
 {
-	if (thread_current() != idle_thread)
+	if (!is_idle_thread(thread_current()))
 		thread_current()->recent_cpu = add_mixed(thread_current()->recent_cpu, 1);
 }
 
+/* Once-a-second update: decays recent_cpu of the running thread
+   and of every ready thread, and recomputes their priorities.
+   Ready threads are drained from each run queue, highest priority
+   first, and pushed back into the buckets of their new priority,
+   which keeps equal-priority threads in their old order.  Blocked
+   threads are left alone until mlfqs_wakeup(), so the cost is
+   proportional to the number of runnable threads. */
 void mlfqs_recalculate_recent_cpu(void)
 {
-	struct list_elem *e;
+	struct thread *cur = thread_current();
+	struct list *stale = &mlfqs_blocked[(mlfqs_epoch + 1) % MLFQS_HISTORY];
 
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	/* Blocked threads last decayed MLFQS_HISTORY - 1 seconds ago
+	   are filed in the bucket the new second reuses, and the
+	   factors they need start to be overwritten soon after: catch
+	   them up to the current second and refile them. */
+	while (!list_empty(stale))
 	{
-		struct thread *t = list_entry(e, struct thread, allelem);
-		mlfqs_calculate_recent_cpu(t);
+		struct thread *t = list_entry(list_pop_front(stale), struct thread, mlfqs_elem);
+
+		mlfqs_catch_up(t);
+		list_push_back(&mlfqs_blocked[mlfqs_epoch % MLFQS_HISTORY], &t->mlfqs_elem);
 	}
+
+	mlfqs_epoch++;
+	mlfqs_decay[mlfqs_epoch % MLFQS_HISTORY] =
+		div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1));
+
+	if (!is_idle_thread(cur))
+	{
+		mlfqs_catch_up(cur);
+		cur->priority = mlfqs_priority(cur);
+	}
+
+	for (unsigned i = 0; i < cpu_cnt; i++)
+	{
+		struct cpu *cpu = &cpus[i];
+		struct list ready;
+
+		list_init(&ready);
+		spin_lock(&cpu->rq_lock);
+		while (cpu->ready_mask != 0)
+		{
+			int priority = ready_queue_max_priority(cpu);
+
+			while (!list_empty(&cpu->ready_queue[priority]))
+			{
+				list_push_back(&ready, list_pop_front(&cpu->ready_queue[priority]));
+				cpu->ready_cnt--;
+			}
+			cpu->ready_mask &= ~(1ULL << priority);
+		}
+		spin_unlock(&cpu->rq_lock);
+
+		while (!list_empty(&ready))
+		{
+			struct thread *t = list_entry(list_pop_front(&ready), struct thread, elem);
+
+			mlfqs_catch_up(t);
+			t->priority = mlfqs_priority(t);
+			ready_queue_push(cpu, t);
+		}
+	}
+
+	if (cur->priority < ready_queue_max_priority(this_cpu()))
+		intr_yield_on_return();
 }
 
+/* Every-fourth-tick update.  Between two once-a-second updates
+   only the running thread's recent_cpu changes, so it is the only
+   priority that needs recomputing. */
 void mlfqs_recalculate_priority(void)
 {
-	struct list_elem *e;
+	struct thread *cur = thread_current();
+
+	if (!is_idle_thread(cur))
+		cur->priority = mlfqs_priority(cur);
 
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	// 현재 스레드의 우선순위가 낮아진 경우 CPU 양보
+	if (cur->priority < ready_queue_max_priority(this_cpu()))
 	{
-		struct thread *t = list_entry(e, struct thread, allelem);
-		mlfqs_calculate_priority(t);
+		intr_yield_on_return();
 	}
+}
 
-	list_sort(&ready_list, thread_priority_compare, NULL);
+/** Completely fair scheduler **/
+
+/* Load weight of each nice value from -20 to 19.  Each step is
+   about 1.25x, so one nice level is worth about 10% of CPU time
+   against a competitor.  Nice 20 shares the weight of nice 19. */
+static const unsigned long cfs_nice_to_weight[40] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906,
+	3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423,
+	335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45,
+	36, 29, 23, 18, 15,
+};
+
+/* Orders a CFS run queue by vruntime, least first. */
+static bool
+cfs_vruntime_less(const struct heap_elem *a, const struct heap_elem *b,
+				  void *aux UNUSED)
+{
+	return heap_entry(a, struct thread, cfs_elem)->vruntime <
+		   heap_entry(b, struct thread, cfs_elem)->vruntime;
+}
 
-	// 현재 스레드의 우선순위가 낮아진 경우 CPU 양보
-	if (!list_empty(&ready_list) && thread_current()->priority < list_entry(list_front(&ready_list), struct thread, elem)->priority)
+/* Returns T's load weight, derived from its nice value. */
+static unsigned long
+cfs_weight(const struct thread *t)
+{
+	int nice = t->nice;
+
+	if (nice < -20)
+		nice = -20;
+	else if (nice > 19)
+		nice = 19;
+	return cfs_nice_to_weight[nice + 20];
+}
+
+/* Advances CPU's min_vruntime, which never goes backward, to the
+   least vruntime among its queued threads and RUNNING (if not
+   null). */
+static void
+cfs_update_min_vruntime(struct cpu *cpu, struct thread *running)
+{
+	int64_t vruntime = INT64_MAX;
+
+	if (running != NULL)
+		vruntime = running->vruntime;
+	if (!heap_empty(&cpu->cfs_queue))
+	{
+		struct thread *t = heap_entry(heap_top(&cpu->cfs_queue), struct thread, cfs_elem);
+		if (t->vruntime < vruntime)
+			vruntime = t->vruntime;
+	}
+	if (vruntime != INT64_MAX && vruntime > cpu->min_vruntime)
+		cpu->min_vruntime = vruntime;
+}
+
+/* Places T, which is about to join CPU's run queue after being
+   created or blocked, relative to CPU's other threads.  A sleeper
+   keeps its own vruntime unless that has fallen more than
+   CFS_SLEEPER_CREDIT behind min_vruntime. */
+static void
+cfs_place(struct cpu *cpu, struct thread *t)
+{
+	int64_t floor = cpu->min_vruntime - CFS_SLEEPER_CREDIT;
+
+	if (t->vruntime < floor)
+		t->vruntime = floor;
+}
+
+/* Charges one timer tick to RUNNING on CPU.  Called from the
+   timer interrupt. */
+static void
+cfs_account(struct cpu *cpu, struct thread *running)
+{
+	running->vruntime += CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT / cfs_weight(running);
+	cfs_update_min_vruntime(cpu, running);
+}
+
+/* Returns the time slice, in ticks, for NEXT, which is about to
+   run on CPU: its weighted share of CFS_LATENCY, but at least
+   CFS_MIN_GRANULARITY. */
+static unsigned
+cfs_slice(struct cpu *cpu, struct thread *next)
+{
+	unsigned long weight = cfs_weight(next);
+	unsigned long slice = CFS_LATENCY * weight / (cpu->cfs_load + weight);
+
+	return slice < CFS_MIN_GRANULARITY ? CFS_MIN_GRANULARITY : slice;
+}
+
+/* Returns true if the running thread CUR should give up its CPU
+   to the leftmost thread in the CFS run queue. */
+static bool
+cfs_should_preempt(struct thread *cur)
+{
+	struct cpu *cpu = cur->cpu;
+	struct thread *t;
+
+	if (heap_empty(&cpu->cfs_queue))
+		return false;
+	if (cur == cpu->idle_thread)
+		return true;
+	t = heap_entry(heap_top(&cpu->cfs_queue), struct thread, cfs_elem);
+	return t->vruntime + CFS_WAKEUP_GRAN < cur->vruntime;
+}
+
+/** Earliest deadline first **/
+
+/* Puts the running thread into the earliest-deadline-first class
+   with the given PERIOD and BUDGET, in timer ticks: from now on,
+   it may run for BUDGET ticks in every PERIOD ticks, ahead of all
+   threads outside the class, and ahead of threads in the class
+   whose current period ends later.  A thread that uses up its
+   budget is throttled until its period ends, so it cannot starve
+   anyone beyond its share.  A PERIOD of 0 takes the thread out of
+   the class again.
+
+   Returns false, without changing anything, if BUDGET is not
+   between 1 and PERIOD, or if admitting the thread would make the
+   sum of budget / period over all threads in the class exceed 1.
+   Locks do not pass deadlines on: an EDF thread waiting for a
+   lock only donates its priority. */
+bool thread_set_deadline(int64_t period, int64_t budget)
+{
+	struct thread *cur = thread_current();
+	unsigned long share, old_share;
+	enum intr_level old_level;
+
+	if (period < 0 || (period > 0 && (budget < 1 || budget > period)))
+		return false;
+
+	old_level = intr_disable();
+	share = period != 0 ? edf_share(period, budget) : 0;
+	old_share = cur->edf_period != 0 ? edf_share(cur->edf_period, cur->edf_budget) : 0;
+	if (edf_utilization - old_share + share > EDF_UTIL_SCALE)
 	{
+		intr_set_level(old_level);
+		return false;
+	}
+	edf_utilization = edf_utilization - old_share + share;
+
+	cur->edf_period = period;
+	cur->edf_budget = budget;
+	cur->edf_deadline = timer_ticks() + period;
+	cur->edf_remaining = budget;
+	cur->cpu->thread_ticks = 0;
+	cur->cpu->time_slice = period != 0 ? budget : TIME_SLICE;
+	intr_set_level(old_level);
+
+	thread_test_preemption();
+	return true;
+}
+
+/* Orders EDF threads by the end of their current period, which is
+   also when a throttled thread gets its budget back. */
+static bool
+edf_deadline_less(const struct heap_elem *a, const struct heap_elem *b,
+				  void *aux UNUSED)
+{
+	return heap_entry(a, struct thread, edf_elem)->edf_deadline <
+		   heap_entry(b, struct thread, edf_elem)->edf_deadline;
+}
+
+/* Returns BUDGET / PERIOD in units of 1/EDF_UTIL_SCALE, rounded
+   up. */
+static unsigned long
+edf_share(int64_t period, int64_t budget)
+{
+	return DIV_ROUND_UP(budget * EDF_UTIL_SCALE, period);
+}
+
+/* EDF thread T is waking up at tick NOW.  If what remains of its
+   budget would let it use more than its share until its deadline,
+   because the deadline is near or has passed, it starts a new
+   period with a full budget instead.  This is the constant
+   bandwidth server's rule: a thread cannot bank budget by
+   sleeping. */
+static void
+edf_wakeup(struct thread *t, int64_t now)
+{
+	if (t->edf_deadline <= now ||
+		t->edf_remaining * t->edf_period > (t->edf_deadline - now) * t->edf_budget)
+	{
+		t->edf_deadline = now + t->edf_period;
+		t->edf_remaining = t->edf_budget;
+	}
+}
+
+/* Charges one timer tick at tick NOW to RUNNING, an EDF thread on
+   CPU.  Called from the timer interrupt.  When its budget runs
+   out, the time slice ends with it and ready_queue_push() throttles
+   the thread.  A thread still running when its period ends, which
+   admission control should prevent, just starts the next one. */
+static void
+edf_account(struct cpu *cpu, struct thread *running, int64_t now)
+{
+	running->edf_remaining--;
+	if (running->edf_remaining > 0 && running->edf_deadline <= now)
+	{
+		running->edf_deadline = now + running->edf_period;
+		running->edf_remaining = running->edf_budget;
+		cpu->thread_ticks = 0;
+		cpu->time_slice = running->edf_remaining + 1;
+	}
+}
+
+/* Gives the throttled EDF threads on CPU whose period has ended
+   at tick NOW a new period and a full budget, and makes them
+   runnable again.  Called from the timer interrupt. */
+static void
+edf_replenish(struct cpu *cpu, int64_t now)
+{
+	bool woken = false;
+
+	spin_lock(&cpu->rq_lock);
+	while (!heap_empty(&cpu->edf_throttled))
+	{
+		struct thread *t = heap_entry(heap_top(&cpu->edf_throttled), struct thread, edf_elem);
+
+		if (t->edf_deadline > now)
+			break;
+		heap_pop(&cpu->edf_throttled);
+		t->edf_deadline += t->edf_period;
+		if (t->edf_deadline <= now)
+			t->edf_deadline = now + t->edf_period;
+		t->edf_remaining = t->edf_budget;
+		heap_push(&cpu->edf_queue, &t->edf_elem);
+		cpu->ready_cnt++;
+		woken = true;
+	}
+	spin_unlock(&cpu->rq_lock);
+
+	if (woken && edf_should_preempt(thread_current()))
 		intr_yield_on_return();
+}
+
+/* Returns true if the running thread CUR should give up its CPU
+   to the EDF thread with the earliest deadline in its run queue:
+   always if CUR is not an EDF thread, otherwise if the queued
+   thread's deadline is earlier. */
+static bool
+edf_should_preempt(struct thread *cur)
+{
+	struct heap_elem *e = heap_top(&cur->cpu->edf_queue);
+
+	if (e == NULL)
+		return false;
+	if (cur->edf_period == 0)
+		return true;
+	return heap_entry(e, struct thread, edf_elem)->edf_deadline < cur->edf_deadline;
+}
+
+/** Lazy FPU state **/
+
+/* Size and alignment of an FXSAVE area. */
+#define FPU_AREA_SIZE 512
+#define FPU_AREA_ALIGN 16
+
+/* FXSAVE image of the FPU as FNINIT leaves it, with all x87 and
+   SSE registers zero and all exceptions masked.  A thread's first
+   FPU instruction starts from this state. */
+static uint8_t fpu_initial_state[FPU_AREA_SIZE]
+	__attribute__((aligned(FPU_AREA_ALIGN)));
+
+/* Returns T's FXSAVE area. */
+static void *
+fpu_area(const struct thread *t)
+{
+	return (void *)ROUND_UP((uintptr_t)t->fpu_mem, FPU_AREA_ALIGN);
+}
+
+/* Enables the x87 FPU and SSE, and sets CR0.TS so that the first
+   FPU instruction raises #NM (see thread_fpu_acquire()).
+
+   FPU state is switched lazily.  Each CPU remembers the thread
+   whose state its FPU registers hold, and schedule() sets CR0.TS
+   whenever it switches to any other thread.  Only when that
+   thread executes an FPU instruction does the #NM handler save
+   the previous owner's registers and load its own.  Threads that
+   never use the FPU never pay for it. */
+static void
+fpu_init(void)
+{
+	lcr4(rcr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+	lcr0((rcr0() & ~CR0_EM) | CR0_MP | CR0_TS);
+
+	*(uint16_t *)&fpu_initial_state[0] = 0x037f;  /* FCW. */
+	*(uint32_t *)&fpu_initial_state[24] = 0x1f80; /* MXCSR. */
+}
+
+/* Sets CR0.TS on CPU unless NEXT owns its FPU. */
+static void
+fpu_switch(struct cpu *cpu, struct thread *next)
+{
+	uint64_t cr0 = rcr0();
+
+	if (cpu->fpu_owner == next)
+	{
+		if (cr0 & CR0_TS)
+			clts();
+	}
+	else if (!(cr0 & CR0_TS))
+		lcr0(cr0 | CR0_TS);
+}
+
+/* Gives the FPU to the running thread, which just used it with
+   CR0.TS set: saves the registers of the thread that last used
+   the FPU and loads the running thread's, allocating its save
+   area on first use.  Called by the #NM handler.  Returns false
+   if memory for the save area is not available. */
+bool thread_fpu_acquire(void)
+{
+	struct thread *cur = thread_current();
+	enum intr_level old_level;
+	struct cpu *cpu;
+
+	if (cur->fpu_mem == NULL)
+	{
+		cur->fpu_mem = malloc(FPU_AREA_SIZE + FPU_AREA_ALIGN - 1);
+		if (cur->fpu_mem == NULL)
+			return false;
+		memcpy(fpu_area(cur), fpu_initial_state, FPU_AREA_SIZE);
+	}
+
+	old_level = intr_disable();
+	cpu = cur->cpu;
+	clts();
+	if (cpu->fpu_owner != cur)
+	{
+		if (cpu->fpu_owner != NULL)
+			fxsave(fpu_area(cpu->fpu_owner));
+		fxrstor(fpu_area(cur));
+		cpu->fpu_owner = cur;
 	}
-}
\ No newline at end of file
+	intr_set_level(old_level);
+
+	return true;
+}
+
+/* Gives the running thread a copy of PARENT's FPU state, as of
+   PARENT's last FPU instruction.  Used by fork().  Returns false
+   if memory for the save area is not available. */
+bool thread_fpu_fork(struct thread *parent)
+{
+	struct thread *cur = thread_current();
+	enum intr_level old_level;
+
+	ASSERT(cur->fpu_mem == NULL);
+
+	if (parent->fpu_mem == NULL)
+		return true;
+
+	cur->fpu_mem = malloc(FPU_AREA_SIZE + FPU_AREA_ALIGN - 1);
+	if (cur->fpu_mem == NULL)
+		return false;
+
+	old_level = intr_disable();
+	if (cur->cpu->fpu_owner == parent)
+	{
+		/* PARENT's latest state is still in the registers. */
+		clts();
+		fxsave(fpu_area(parent));
+		lcr0(rcr0() | CR0_TS);
+	}
+	memcpy(fpu_area(cur), fpu_area(parent), FPU_AREA_SIZE);
+	intr_set_level(old_level);
+
+	return true;
+}
+
+/* Discards the running thread's FPU state, so that it starts
+   over from the initial state if it uses the FPU again. */
+void thread_fpu_release(void)
+{
+	struct thread *cur = thread_current();
+	enum intr_level old_level;
+	void *mem;
+
+	old_level = intr_disable();
+	if (cur->cpu->fpu_owner == cur)
+	{
+		cur->cpu->fpu_owner = NULL;
+		lcr0(rcr0() | CR0_TS);
+	}
+	mem = cur->fpu_mem;
+	cur->fpu_mem = NULL;
+	intr_set_level(old_level);
+
+	free(mem);
+}
@@ -0,0 +1,342 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Deferred work.
+
+   A workqueue is a FIFO of work items served by one or more
+   worker threads of a chosen priority.  Anyone, interrupt
+   handlers included, can queue an item; a worker later calls its
+   function in thread context, where it may sleep, take locks and
+   allocate memory.  A worker takes up to `batch' items at a time
+   and runs them back to back before it looks at the queue again.
+   Items waiting in a worker's batch are claimed (WORK_RUNNING):
+   they still count as queued, so they cannot be queued again
+   until the worker takes them out of the batch to run them.
+
+   Delayed work sits in a per-queue heap ordered by due tick until
+   the timer interrupt moves it to the FIFO (workqueue_timer()).
+
+   All of a queue's state is protected by its spin lock, so it
+   can be used with interrupts off.  Semaphores are upped only
+   after the spin lock is released, because sema_up() may yield. */
+
+/* All workqueues, for workqueue_timer(). */
+static struct workqueue *all_queues;
+
+/* A thread waiting in workqueue_flush(). */
+struct flusher {
+	struct list_elem elem;      /* Element in `flushers'. */
+	struct semaphore done;      /* Upped when the queue is idle. */
+};
+
+static void worker (void *wq_);
+static void take_flushers (struct workqueue *, struct list *);
+static void wake_flushers (struct list *);
+static bool work_due_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+
+/* Initializes WQ and starts WORKER_CNT worker threads named NAME
+   at PRIORITY to serve it, each running up to BATCH items per
+   wakeup.  WQ must stay allocated for as long as the kernel
+   runs, because workers are never stopped. */
+void
+workqueue_init (struct workqueue *wq, const char *name, int priority,
+		unsigned worker_cnt, size_t batch) {
+	enum intr_level old_level;
+	unsigned i;
+
+	ASSERT (wq != NULL);
+	ASSERT (name != NULL);
+	ASSERT (worker_cnt > 0);
+	ASSERT (batch > 0);
+
+	strlcpy (wq->name, name, sizeof wq->name);
+	spin_lock_init (&wq->lock);
+	list_init (&wq->pending);
+	heap_init (&wq->delayed, work_due_less, NULL);
+	sema_init (&wq->work_cnt, 0);
+	wq->batch = batch;
+	wq->busy_cnt = 0;
+	list_init (&wq->flushers);
+
+	old_level = intr_disable ();
+	wq->next = all_queues;
+	all_queues = wq;
+	intr_set_level (old_level);
+
+	for (i = 0; i < worker_cnt; i++)
+		if (thread_create (name, priority, worker, wq) == TID_ERROR)
+			PANIC ("workqueue %s: cannot start worker", name);
+}
+
+/* Initializes W as an idle work item that runs FUNC, with AUX
+   for FUNC's use. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->state = WORK_IDLE;
+	w->wq = NULL;
+}
+
+/* Queues W on WQ.  Returns false, without doing anything, if W
+   is already pending, delayed or claimed by a worker.  W may be
+   queued again while it is running, including by its own
+   function.  May be called from an interrupt handler. */
+bool
+workqueue_queue (struct workqueue *wq, struct work *w) {
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL);
+
+	spin_lock (&wq->lock);
+	if (w->state != WORK_IDLE) {
+		spin_unlock (&wq->lock);
+		return false;
+	}
+	w->wq = wq;
+	w->state = WORK_PENDING;
+	list_push_back (&wq->pending, &w->elem);
+	spin_unlock (&wq->lock);
+
+	sema_up (&wq->work_cnt);
+	return true;
+}
+
+/* Queues W on WQ once TICKS timer ticks have passed, or at once
+   if TICKS is not positive.  Returns false, without doing
+   anything, if W is already pending, delayed or claimed by a
+   worker.  May be called from an interrupt handler. */
+bool
+workqueue_queue_delayed (struct workqueue *wq, struct work *w,
+		int64_t ticks) {
+	int64_t due;
+
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL);
+
+	if (ticks <= 0)
+		return workqueue_queue (wq, w);
+
+	due = timer_ticks () + ticks;
+	spin_lock (&wq->lock);
+	if (w->state != WORK_IDLE) {
+		spin_unlock (&wq->lock);
+		return false;
+	}
+	w->wq = wq;
+	w->state = WORK_DELAYED;
+	w->due = due;
+	heap_push (&wq->delayed, &w->timer_elem);
+	spin_unlock (&wq->lock);
+	return true;
+}
+
+/* Takes W off its queue if it is pending, delayed or claimed by
+   a worker but not yet started.  Returns true if it was, false if
+   it was idle, in which case it may still be running; use
+   workqueue_flush() to wait for that.  May be called from an
+   interrupt handler. */
+bool
+workqueue_cancel (struct work *w) {
+	struct workqueue *wq;
+	struct list flushers;
+	bool cancelled = true;
+
+	ASSERT (w != NULL);
+
+	wq = w->wq;
+	if (wq == NULL)
+		return false;
+
+	list_init (&flushers);
+	spin_lock (&wq->lock);
+	if (w->state == WORK_PENDING) {
+		list_remove (&w->elem);
+
+		/* Take back the item's wakeup.  If a worker has already
+		   consumed it, the worker finds one item fewer. */
+		sema_try_down (&wq->work_cnt);
+	} else if (w->state == WORK_RUNNING) {
+		/* Waiting in a worker's batch, whose wakeup is spent. */
+		list_remove (&w->elem);
+	} else if (w->state == WORK_DELAYED)
+		heap_remove (&wq->delayed, &w->timer_elem);
+	else
+		cancelled = false;
+	w->state = WORK_IDLE;
+	take_flushers (wq, &flushers);
+	spin_unlock (&wq->lock);
+
+	wake_flushers (&flushers);
+	return cancelled;
+}
+
+/* Waits until WQ has no pending items and none of its workers is
+   running one.  Delayed items that are not yet due are not
+   waited for.  Must not be called by one of WQ's own workers. */
+void
+workqueue_flush (struct workqueue *wq) {
+	struct flusher f;
+	bool idle;
+
+	ASSERT (wq != NULL);
+	ASSERT (!intr_context ());
+
+	sema_init (&f.done, 0);
+	spin_lock (&wq->lock);
+	idle = list_empty (&wq->pending) && wq->busy_cnt == 0;
+	if (!idle)
+		list_push_back (&wq->flushers, &f.elem);
+	spin_unlock (&wq->lock);
+
+	if (!idle)
+		sema_down (&f.done);
+}
+
+/* Moves delayed work that is due by tick NOW to the pending
+   lists.  Called by the timer interrupt handler. */
+void
+workqueue_timer (int64_t now) {
+	struct workqueue *wq;
+
+	for (wq = all_queues; wq != NULL; wq = wq->next) {
+		unsigned cnt = 0;
+
+		spin_lock (&wq->lock);
+		while (!heap_empty (&wq->delayed)) {
+			struct work *w = heap_entry (heap_top (&wq->delayed),
+					struct work, timer_elem);
+
+			if (w->due > now)
+				break;
+			heap_pop (&wq->delayed);
+			w->state = WORK_PENDING;
+			list_push_back (&wq->pending, &w->elem);
+			cnt++;
+		}
+		spin_unlock (&wq->lock);
+
+		while (cnt-- > 0)
+			sema_up (&wq->work_cnt);
+	}
+}
+
+/* Returns the earliest tick at which some delayed work falls due,
+   or INT64_MAX if there is none.  Interrupts must be off. */
+int64_t
+workqueue_next_due (void) {
+	struct workqueue *wq;
+	int64_t next_due = INT64_MAX;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (wq = all_queues; wq != NULL; wq = wq->next)
+		if (!heap_empty (&wq->delayed)) {
+			struct work *w = heap_entry (heap_top (&wq->delayed),
+					struct work, timer_elem);
+
+			if (w->due < next_due)
+				next_due = w->due;
+		}
+	return next_due;
+}
+
+/* Worker thread function.  Waits for work on WQ_, then runs up
+   to `batch' items in FIFO order. */
+static void
+worker (void *wq_) {
+	struct workqueue *wq = wq_;
+
+	for (;;) {
+		struct list batch;
+		struct list flushers;
+		size_t cnt = 0;
+
+		sema_down (&wq->work_cnt);
+
+		/* The first item uses the wakeup just consumed, each
+		   further one in the batch consumes its own. */
+		list_init (&batch);
+		spin_lock (&wq->lock);
+		while (!list_empty (&wq->pending) && cnt < wq->batch
+				&& (cnt == 0 || sema_try_down (&wq->work_cnt))) {
+			struct work *w = list_entry (list_pop_front (&wq->pending),
+					struct work, elem);
+
+			w->state = WORK_RUNNING;
+			list_push_back (&batch, &w->elem);
+			cnt++;
+		}
+		if (cnt > 0)
+			wq->busy_cnt++;
+		spin_unlock (&wq->lock);
+
+		if (cnt == 0)
+			continue;
+
+		/* Unlink each item and make it idle before running it,
+		   since its function may queue it again.  The batch is
+		   only touched under the lock, because workqueue_cancel()
+		   may take items out of it. */
+		for (;;) {
+			struct work *w;
+
+			spin_lock (&wq->lock);
+			if (list_empty (&batch)) {
+				spin_unlock (&wq->lock);
+				break;
+			}
+			w = list_entry (list_pop_front (&batch), struct work, elem);
+			w->state = WORK_IDLE;
+			spin_unlock (&wq->lock);
+
+			w->func (w);
+		}
+
+		list_init (&flushers);
+		spin_lock (&wq->lock);
+		wq->busy_cnt--;
+		take_flushers (wq, &flushers);
+		spin_unlock (&wq->lock);
+		wake_flushers (&flushers);
+	}
+}
+
+/* If WQ is idle, moves the threads waiting for that to FLUSHERS.
+   WQ's lock must be held. */
+static void
+take_flushers (struct workqueue *wq, struct list *flushers) {
+	ASSERT (spin_lock_held (&wq->lock));
+
+	if (list_empty (&wq->pending) && wq->busy_cnt == 0)
+		while (!list_empty (&wq->flushers))
+			list_push_back (flushers, list_pop_front (&wq->flushers));
+}
+
+/* Wakes the threads in FLUSHERS, taken by take_flushers(). */
+static void
+wake_flushers (struct list *flushers) {
+	while (!list_empty (flushers)) {
+		struct flusher *f = list_entry (list_pop_front (flushers),
+				struct flusher, elem);
+
+		sema_up (&f->done);
+	}
+}
+
+/* Orders delayed work items by due tick. */
+static bool
+work_due_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct work *a = heap_entry (a_, struct work, timer_elem);
+	const struct work *b = heap_entry (b_, struct work, timer_elem);
+
+	return a->due < b->due;
+}
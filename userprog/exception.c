@@ -11,6 +11,7 @@ static long long page_fault_cnt;
 
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
+static void device_not_available(struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -45,7 +46,7 @@ void exception_init(void)
 	intr_register_int(0, 0, INTR_ON, kill, "#DE Divide Error");
 	intr_register_int(1, 0, INTR_ON, kill, "#DB Debug Exception");
 	intr_register_int(6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-	intr_register_int(7, 0, INTR_ON, kill,
+	intr_register_int(7, 0, INTR_ON, device_not_available,
 					  "#NM Device Not Available Exception");
 	intr_register_int(11, 0, INTR_ON, kill, "#NP Segment Not Present");
 	intr_register_int(12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
@@ -107,6 +108,16 @@ kill(struct intr_frame *f)
 	}
 }
 
+/* #NM handler.  The running thread used the FPU while CR0.TS
+   was set, because its FPU state is not loaded; see fpu_init() in
+   threads/thread.c.  Load it and restart the instruction. */
+static void
+device_not_available(struct intr_frame *f)
+{
+	if (!thread_fpu_acquire())
+		kill(f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
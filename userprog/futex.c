@@ -0,0 +1,253 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stddef.h>
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Fast user-space mutual exclusion.
+
+   User programs keep their locks in ordinary memory and only
+   call into the kernel when a lock is contended: to sleep until
+   the int that holds its state changes, or to wake threads that
+   sleep on it.  The kernel keeps no state for a futex without
+   waiters.
+
+   A waiting thread is keyed by the kernel virtual address of the
+   int it waits on, that is, by its physical frame and offset, so
+   that processes sharing a frame also share its waiters.  Waiters
+   are hashed into a fixed number of buckets, each with its own
+   lock.  FUTEX_WAIT checks the value of the int while holding
+   the bucket lock, and wakers take the same lock, so a wakeup
+   that follows a change of the value is never lost.
+
+   The kernel never evicts user pages, so the frame of a waiting
+   thread's int stays put for as long as the thread waits.
+
+   When a process exits, futex_wake_process() wakes all of its
+   waiters so that they can die, and FUTEX_WAIT refuses to sleep
+   in a process that is exiting. */
+
+/* Number of hash buckets.  Must be a power of 2. */
+#define FUTEX_BUCKETS 64
+
+/* A bucket of waiters. */
+struct futex_bucket {
+	struct lock lock;           /* Protects `waiters'. */
+	struct list waiters;        /* List of struct futex_waiter. */
+};
+
+/* A thread blocked in FUTEX_WAIT.  Lives on its stack. */
+struct futex_waiter {
+	const int *key;             /* Kernel address of the int. */
+	struct thread *thread;      /* The waiting thread. */
+	struct semaphore sema;      /* Upped to wake the thread. */
+	struct list_elem elem;      /* Element in a bucket's `waiters'. */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+static const int *futex_key (uint64_t *pml4, int *uaddr);
+static struct futex_bucket *futex_bucket (const int *key);
+static int futex_wake_bucket (struct futex_bucket *, const int *key, int n);
+static bool waiter_less_priority (const struct list_elem *,
+		const struct list_elem *, void *aux);
+
+/* Initializes the futex hash table. */
+void
+futex_init (void) {
+	size_t i;
+
+	for (i = 0; i < FUTEX_BUCKETS; i++) {
+		lock_init (&buckets[i].lock);
+		list_init (&buckets[i].waiters);
+	}
+}
+
+/* Blocks the current thread until woken by futex_wake() or
+   futex_requeue(), provided the int at UADDR in PML4 equals VAL.
+   Returns 0 after being woken, or -1 if the value differed or
+   UADDR is not mapped. */
+int
+futex_wait (uint64_t *pml4, int *uaddr, int val) {
+	const int *key = futex_key (pml4, uaddr);
+	struct futex_bucket *b;
+	struct futex_waiter w;
+
+	if (key == NULL)
+		return -1;
+
+	b = futex_bucket (key);
+	lock_acquire (&b->lock);
+	if (*key != val || thread_current ()->leader->exiting) {
+		lock_release (&b->lock);
+		return -1;
+	}
+	w.key = key;
+	w.thread = thread_current ();
+	sema_init (&w.sema, 0);
+	list_push_back (&b->waiters, &w.elem);
+	lock_release (&b->lock);
+
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* Wakes up to N threads waiting on the int at UADDR in PML4,
+   highest priority first.  Returns the number woken. */
+int
+futex_wake (uint64_t *pml4, int *uaddr, int n) {
+	const int *key = futex_key (pml4, uaddr);
+	struct futex_bucket *b;
+	int woken;
+
+	if (key == NULL)
+		return -1;
+
+	b = futex_bucket (key);
+	lock_acquire (&b->lock);
+	woken = futex_wake_bucket (b, key, n);
+	lock_release (&b->lock);
+	return woken;
+}
+
+/* Wakes up to N threads waiting on the int at UADDR in PML4, then
+   moves up to N2 of the remaining waiters to wait on the int at
+   UADDR2 instead.  Returns the number of threads woken or moved.
+
+   Used to broadcast a condition variable without waking every
+   waiter only to have all but one block again on the mutex. */
+int
+futex_requeue (uint64_t *pml4, int *uaddr, int n, int *uaddr2, int n2) {
+	const int *key = futex_key (pml4, uaddr);
+	const int *key2 = futex_key (pml4, uaddr2);
+	struct futex_bucket *b, *b2;
+	struct list_elem *e;
+	int cnt;
+
+	if (key == NULL || key2 == NULL)
+		return -1;
+
+	/* Lock both buckets, lower address first, to avoid deadlock
+	   with a concurrent requeue in the opposite direction. */
+	b = futex_bucket (key);
+	b2 = futex_bucket (key2);
+	if (b < b2) {
+		lock_acquire (&b->lock);
+		lock_acquire (&b2->lock);
+	} else {
+		lock_acquire (&b2->lock);
+		if (b2 != b)
+			lock_acquire (&b->lock);
+	}
+
+	cnt = futex_wake_bucket (b, key, n);
+	for (e = list_begin (&b->waiters);
+			e != list_end (&b->waiters) && n2 > 0; ) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+		e = list_next (e);
+		if (w->key == key) {
+			list_remove (&w->elem);
+			w->key = key2;
+			list_push_back (&b2->waiters, &w->elem);
+			cnt++;
+			n2--;
+		}
+	}
+
+	if (b2 != b)
+		lock_release (&b2->lock);
+	lock_release (&b->lock);
+	return cnt;
+}
+
+/* Wakes every thread of the process led by LEADER that waits in
+   futex_wait(), whatever it waits on.  LEADER's `exiting' must
+   already be set. */
+void
+futex_wake_process (struct thread *leader) {
+	size_t i;
+
+	ASSERT (leader->exiting);
+
+	for (i = 0; i < FUTEX_BUCKETS; i++) {
+		struct futex_bucket *b = &buckets[i];
+		struct list_elem *e;
+
+		lock_acquire (&b->lock);
+		for (e = list_begin (&b->waiters); e != list_end (&b->waiters); ) {
+			struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+			e = list_next (e);
+			if (w->thread->leader == leader) {
+				list_remove (&w->elem);
+				sema_up (&w->sema);
+			}
+		}
+		lock_release (&b->lock);
+	}
+}
+
+/* Returns the kernel address through which the int at UADDR in
+   PML4 can be read, or a null pointer if UADDR is not mapped. */
+static const int *
+futex_key (uint64_t *pml4, int *uaddr) {
+	ASSERT (pml4 != NULL);
+
+	if (!is_user_vaddr (uaddr) || (uintptr_t) uaddr % sizeof *uaddr != 0)
+		return NULL;
+	return pml4_get_page (pml4, uaddr);
+}
+
+/* Returns the bucket for KEY. */
+static struct futex_bucket *
+futex_bucket (const int *key) {
+	return &buckets[hash_bytes (&key, sizeof key) & (FUTEX_BUCKETS - 1)];
+}
+
+/* Wakes up to N threads waiting on KEY in B, highest priority
+   first, and returns the number woken.  B's lock must be held. */
+static int
+futex_wake_bucket (struct futex_bucket *b, const int *key, int n) {
+	int woken = 0;
+
+	ASSERT (lock_held_by_current_thread (&b->lock));
+
+	while (woken < n) {
+		struct list_elem *e;
+		struct futex_waiter *w;
+
+		e = list_max (&b->waiters, waiter_less_priority, (void *) key);
+		if (e == list_end (&b->waiters))
+			break;
+		w = list_entry (e, struct futex_waiter, elem);
+		if (w->key != key)
+			break;
+
+		list_remove (&w->elem);
+		sema_up (&w->sema);
+		woken++;
+	}
+	return woken;
+}
+
+/* Orders waiters on the key in AUX by priority.  Waiters on other
+   keys that share the bucket compare less than all of them, so
+   list_max() only returns one of those if there is no waiter on
+   the key.  Among waiters of equal priority, list_max() returns
+   the one that has waited longest. */
+static bool
+waiter_less_priority (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux) {
+	const struct futex_waiter *a = list_entry (a_, struct futex_waiter, elem);
+	const struct futex_waiter *b = list_entry (b_, struct futex_waiter, elem);
+	const int *key = aux;
+
+	if (a->key != key || b->key != key)
+		return a->key != key && b->key == key;
+	return a->thread->priority < b->thread->priority;
+}
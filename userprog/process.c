@@ -5,7 +5,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,6 +16,7 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -26,6 +29,20 @@ static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void start_user_thread(void *leader_);
+static void reap_members(struct thread *leader);
+static void member_exit(void);
+static uint8_t *user_stack_top(int slot);
+static bool user_stack_alloc(void *upage);
+static void user_stack_free(struct thread *leader, void *upage);
+
+/* Most threads a process may have, including its leader.  Each
+   one's index into the leader's `stack_map' selects its stack. */
+#define USER_THREAD_MAX 32
+
+/* Address space reserved below USER_STACK for each thread's user
+   stack.  Only the top page is mapped up front. */
+#define USER_STACK_SPAN (64 * PGSIZE)
 
 /* General process initializer for initd and other process. */
 static void
@@ -124,6 +141,25 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux)
 	if (is_kernel_vaddr(va))
 		return true;
 
+	/* A large page is copied whole, into a large page of its own. */
+	if (*pte & PTE_PS)
+	{
+		parent_page = pml4_get_page(parent->pml4, va);
+		newpage = palloc_get_multiple(PAL_USER, LARGE_PGCNT);
+		if (parent_page == NULL || newpage == NULL)
+		{
+			palloc_free_multiple(newpage, LARGE_PGCNT);
+			return false;
+		}
+		memcpy(newpage, parent_page, LARGE_PGSIZE);
+		if (!pml4_set_large_page(current->pml4, va, newpage, is_writable(pte)))
+		{
+			palloc_free_multiple(newpage, LARGE_PGCNT);
+			return false;
+		}
+		return true;
+	}
+
 	// 2. 부모의 페이지를 가져오고 가져오기에 실패하면 false 반환 후 종료
 	parent_page = pml4_get_page(parent->pml4, va);
 	if (parent_page == NULL)
@@ -178,18 +214,25 @@ static void __do_fork(void *aux)
 	process_activate(current);
 #ifdef VM
 	supplemental_page_table_init(&current->spt);
-	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
+	if (!supplemental_page_table_copy(&current->spt, &parent->leader->spt))
 		goto error;
 #else
 	if (!pml4_for_each(parent->pml4, duplicate_pte, parent)) // Page Table 통째로 복제
 		goto error;
 #endif
 
+	// 부모의 FPU 상태 복제
+	if (!thread_fpu_fork(parent))
+		goto error;
+
 	// 부모의 파일 디스크립터 인덱스가 최댓값을 넘어가면 종료
+	// (파일 디스크립터 테이블은 부모 프로세스의 leader가 가지고 있음)
+	parent = parent->leader;
 	if (parent->fd_idx >= FDCOUNT_LIMIT)
 		goto error;
 
 	// 부모의 파일 디스크립터 인덱스, 파일 디스크립터 테이블 복제
+	lock_acquire(&parent->proc_lock);
 	current->fd_idx = parent->fd_idx;
 	for (int fd = 3; fd < parent->fd_idx; fd++)
 	{
@@ -197,6 +240,7 @@ static void __do_fork(void *aux)
 			continue;
 		current->fdt[fd] = file_duplicate(parent->fdt[fd]);
 	}
+	lock_release(&parent->proc_lock);
 
 	// fork 프로세스가 정상적으로 완료됐으므로 현재 fork용 sema unblock
 	sema_up(&current->fork_sema);
@@ -229,8 +273,18 @@ int process_exec(void *f_name)
 	_if.cs = SEL_UCSEG;
 	_if.eflags = FLAG_IF | FLAG_MBS;
 
+	/* Replacing the image would pull the address space out from
+	 * under the process's other threads, so only allow it in a
+	 * single-threaded process. */
+	if (!process_single_threaded())
+	{
+		palloc_free_page(file_name);
+		return -1;
+	}
+
 	/* We first kill the current context */
 	process_cleanup();
+	thread_fpu_release();
 
 	/** #Project 2: Argument Passing - 문자열 분리 */
 	// strtok_r 함수를 이용하여 공백을 NULL 문자로 변환, 분리
@@ -301,6 +355,17 @@ void process_exit(void)
 {
 	struct thread *curr = thread_current();
 
+	// 프로세스의 다른 스레드는 자원을 해제하지 않고 leader에게 회수됨
+	if (curr != curr->leader)
+	{
+		member_exit();
+		return;
+	}
+
+	// 나머지 스레드를 모두 종료시키고 회수
+	process_mark_exiting(curr->exit_status);
+	reap_members(curr);
+
 	// 파일 디스크립터 테이블 내용 삭제
 	for (int fd = 0; fd < curr->fd_idx; fd++)
 		close(fd);
@@ -825,38 +890,352 @@ struct thread *get_child_process(int pid)
 // File Descriptor Table에 파일을 추가 하는 함수
 int process_add_file(struct file *f)
 {
-	struct thread *curr = thread_current();
-	struct file **fdt = curr->fdt;
-
-	if (curr->fd_idx >= FDCOUNT_LIMIT)
-		return -1;
+	struct thread *proc = thread_current()->leader;
+	int fd = -1;
 
-	fdt[curr->fd_idx++] = f;
+	lock_acquire(&proc->proc_lock);
+	if (proc->fd_idx < FDCOUNT_LIMIT)
+	{
+		fd = proc->fd_idx++;
+		proc->fdt[fd] = f;
+	}
+	lock_release(&proc->proc_lock);
 
-	return curr->fd_idx - 1;
+	return fd;
 }
 
 /** #Project 2: System Call **/
 // File Descriptor Table에서 파일의 정보를 가져오는 함수
+// 다른 스레드가 fd를 닫아도 안전하도록 참조를 하나 더해서 반환하므로,
+// 다 쓴 뒤에는 file_close()로 참조를 놓아야 함
 struct file *process_get_file(int fd)
 {
-	struct thread *curr = thread_current();
+	struct thread *proc = thread_current()->leader;
+	struct file *file;
 
-	if (fd >= FDCOUNT_LIMIT)
+	// 0~2는 표준 입출력용 예약 자리 (파일 아님)
+	if (fd < 3 || fd >= FDCOUNT_LIMIT)
 		return NULL;
 
-	return curr->fdt[fd];
+	lock_acquire(&proc->proc_lock);
+	file = proc->fdt[fd];
+	if (file != NULL)
+		file_ref(file);
+	lock_release(&proc->proc_lock);
+
+	return file;
 }
 
 /** #Project 2: System Call **/
-// File Descriptor Table에서 파일을 삭제하는 함수
-int process_close_file(int fd)
+// File Descriptor Table에서 파일을 삭제하고, 삭제한 파일을 반환하는 함수
+// (없으면 NULL) - 같은 fd를 두 스레드가 닫아도 한쪽만 파일을 받음
+struct file *process_close_file(int fd)
+{
+	struct thread *proc = thread_current()->leader;
+	struct file *file;
+
+	if (fd < 3 || fd >= FDCOUNT_LIMIT)
+		return NULL;
+
+	lock_acquire(&proc->proc_lock);
+	file = proc->fdt[fd];
+	proc->fdt[fd] = NULL;
+	lock_release(&proc->proc_lock);
+	return file;
+}
+/* User threads.
+ *
+ * A process starts with one thread, its leader, which owns the
+ * address space, the file descriptor table and the exit status.
+ * process_thread_create() adds threads that share the leader's
+ * `pml4' and `fdt', each with its own user stack carved out of
+ * the region below USER_STACK.  Threads other than the leader are
+ * not children of anyone: they are kept in the leader's `members'
+ * list and reaped with process_thread_join() or, at the latest,
+ * by the leader when the process exits.
+ *
+ * exit() from any thread ends the whole process with that
+ * status.  It marks the process as exiting; the other threads die
+ * on their next way back to user mode (process_check_exit()), and
+ * those asleep in futex() are woken to do so.  The leader waits
+ * in process_exit() until all other threads are gone, and only
+ * then tears down the address space. */
+
+/** User threads - 같은 주소 공간을 공유하는 스레드를 새로 만드는 함수 **/
+// 새 스레드는 user 모드의 START(FUNC, AUX)에서 실행을 시작함
+tid_t process_thread_create(void *start, void *func, void *aux)
+{
+	struct thread *curr = thread_current();
+	struct thread *leader = curr->leader;
+	struct thread *t;
+	void *stack;
+	int slot;
+	tid_t tid;
+
+	if (!is_user_vaddr(start))
+		return TID_ERROR;
+
+	// 비어 있는 스택 슬롯을 찾아서 스택 페이지를 할당
+	lock_acquire(&leader->proc_lock);
+	for (slot = 1; slot < USER_THREAD_MAX; slot++)
+		if ((leader->stack_map & (1u << slot)) == 0)
+			break;
+	if (leader->exiting || slot == USER_THREAD_MAX ||
+		!user_stack_alloc(user_stack_top(slot) - PGSIZE))
+	{
+		lock_release(&leader->proc_lock);
+		return TID_ERROR;
+	}
+	leader->stack_map |= 1u << slot;
+	lock_release(&leader->proc_lock);
+
+	tid = thread_create(curr->name, PRI_DEFAULT, start_user_thread, leader);
+	if (tid == TID_ERROR)
+	{
+		lock_acquire(&leader->proc_lock);
+		user_stack_free(leader, user_stack_top(slot) - PGSIZE);
+		leader->stack_map &= ~(1u << slot);
+		lock_release(&leader->proc_lock);
+		return TID_ERROR;
+	}
+
+	// thread_create()가 자식 리스트에 넣은 스레드를 프로세스의 스레드 목록으로 옮김
+	// (새 스레드는 fork_sema를 기다리고 있으므로 아직 실행되지 않음)
+	t = get_child_process(tid);
+	list_remove(&t->child_elem);
+
+	stack = user_stack_top(slot);
+	memset(&t->parent_if, 0, sizeof t->parent_if);
+	t->parent_if.ds = t->parent_if.es = t->parent_if.ss = SEL_UDSEG;
+	t->parent_if.cs = SEL_UCSEG;
+	t->parent_if.eflags = FLAG_IF | FLAG_MBS;
+	t->parent_if.rip = (uintptr_t)start;
+	t->parent_if.R.rdi = (uint64_t)func;
+	t->parent_if.R.rsi = (uint64_t)aux;
+	t->parent_if.rsp = (uintptr_t)stack - sizeof(void *); // 가짜 return 주소 (0)
+	t->stack_slot = slot;
+	t->leader = leader;
+
+	lock_acquire(&leader->proc_lock);
+	list_push_back(&leader->members, &t->member_elem);
+	lock_release(&leader->proc_lock);
+
+	sema_up(&t->fork_sema);
+	return tid;
+}
+
+/* A thread function that enters user mode in a new thread of
+ * process LEADER_, once process_thread_create() has set it up. */
+static void
+start_user_thread(void *leader_)
+{
+	struct thread *leader = leader_;
+	struct thread *curr = thread_current();
+	struct intr_frame if_;
+
+	sema_down(&curr->fork_sema);
+
+	// 프로세스의 페이지 테이블과 파일 디스크립터 테이블을 공유
+	palloc_free_multiple(curr->fdt, FDT_PAGES);
+	curr->fdt = leader->fdt;
+	curr->pml4 = leader->pml4;
+	process_activate(curr);
+
+	// process_thread_exit()를 거치지 않고 죽으면 프로세스 전체를 종료
+	curr->exit_status = -1;
+
+	memcpy(&if_, &curr->parent_if, sizeof if_);
+	process_check_exit();
+	do_iret(&if_);
+	NOT_REACHED();
+}
+
+/** User threads - 현재 스레드만 종료하는 함수 **/
+// leader가 호출하면 다른 스레드가 모두 끝나기를 기다린 뒤 프로세스를 exit(0)으로 종료
+void process_thread_exit(void)
+{
+	struct thread *curr = thread_current();
+
+	if (curr == curr->leader)
+	{
+		reap_members(curr);
+		exit(0);
+	}
+
+	curr->exit_status = 0;
+	thread_exit();
+}
+
+/** User threads - 같은 프로세스의 스레드 TID가 끝나기를 기다리는 함수 **/
+// 성공하면 0, TID가 이 프로세스의 (leader가 아닌) 다른 스레드가 아니거나 이미 join되었으면 -1 반환
+int process_thread_join(tid_t tid)
 {
 	struct thread *curr = thread_current();
+	struct thread *leader = curr->leader;
+	struct thread *t = NULL;
+	struct list_elem *e;
 
-	if (fd >= FDCOUNT_LIMIT)
+	lock_acquire(&leader->proc_lock);
+	for (e = list_begin(&leader->members); e != list_end(&leader->members); e = list_next(e))
+	{
+		struct thread *m = list_entry(e, struct thread, member_elem);
+
+		if (m->tid == tid && m != curr)
+		{
+			t = m;
+			list_remove(&t->member_elem);
+			break;
+		}
+	}
+	lock_release(&leader->proc_lock);
+
+	if (t == NULL)
 		return -1;
 
-	curr->fdt[fd] = NULL;
+	sema_down(&t->wait_sema);
+	sema_up(&t->exit_sema);
 	return 0;
-}
\ No newline at end of file
+}
+
+/* Marks the current thread's process as exiting with STATUS,
+ * unless some thread already did so, and wakes its threads that
+ * sleep in futex().  Returns true if this call marked it. */
+bool process_mark_exiting(int status)
+{
+	struct thread *leader = thread_current()->leader;
+	bool marked = false;
+	bool threaded;
+
+	lock_acquire(&leader->proc_lock);
+	if (!leader->exiting)
+	{
+		leader->exiting = true;
+		leader->exit_status = status;
+		marked = true;
+	}
+	threaded = !list_empty(&leader->members);
+	lock_release(&leader->proc_lock);
+
+	if (marked && threaded)
+		futex_wake_process(leader);
+	return marked;
+}
+
+/* Exits the current thread if its process is exiting.  Called
+ * on the way back to user mode, possibly with interrupts off. */
+void process_check_exit(void)
+{
+	if (thread_current()->leader->exiting)
+	{
+		intr_enable();
+		thread_exit();
+	}
+}
+
+/* Returns true if the current thread is the only thread of its
+ * process. */
+bool process_single_threaded(void)
+{
+	struct thread *curr = thread_current();
+
+	return curr == curr->leader && list_empty(&curr->members);
+}
+
+/* Waits for every thread of LEADER's process other than LEADER
+ * itself to exit, and reaps them. */
+static void
+reap_members(struct thread *leader)
+{
+	for (;;)
+	{
+		struct thread *t;
+
+		lock_acquire(&leader->proc_lock);
+		if (list_empty(&leader->members))
+		{
+			lock_release(&leader->proc_lock);
+			break;
+		}
+		t = list_entry(list_pop_front(&leader->members), struct thread, member_elem);
+		lock_release(&leader->proc_lock);
+
+		sema_down(&t->wait_sema);
+		sema_up(&t->exit_sema);
+	}
+}
+
+/* process_exit() for a thread other than its process's leader:
+ * gives back its user stack and waits to be reaped.  A thread that
+ * dies without process_thread_exit(), e.g. killed by an
+ * exception, takes the whole process down with it. */
+static void
+member_exit(void)
+{
+	struct thread *curr = thread_current();
+	struct thread *leader = curr->leader;
+
+	if (curr->exit_status != 0)
+		process_mark_exiting(-1);
+
+	lock_acquire(&leader->proc_lock);
+	user_stack_free(leader, user_stack_top(curr->stack_slot) - PGSIZE);
+	leader->stack_map &= ~(1u << curr->stack_slot);
+	lock_release(&leader->proc_lock);
+
+	// 공유하던 자원은 leader가 해제함
+	curr->pml4 = NULL;
+	curr->fdt = NULL;
+
+	sema_up(&curr->wait_sema);
+	sema_down(&curr->exit_sema);
+}
+
+/* Returns the user address just above the stack in SLOT. */
+static uint8_t *
+user_stack_top(int slot)
+{
+	return (uint8_t *)USER_STACK - slot * USER_STACK_SPAN;
+}
+
+/* Maps a zeroed, writable page at UPAGE in the current process
+ * for use as a thread's stack.  The leader's `proc_lock' must be
+ * held, since all threads of the process share the page table. */
+static bool
+user_stack_alloc(void *upage)
+{
+#ifdef VM
+	return vm_alloc_page(VM_ANON | VM_MARKER_0, upage, true) && vm_claim_page(upage);
+#else
+	uint8_t *kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+
+	if (kpage == NULL)
+		return false;
+	if (!install_page(upage, kpage, true))
+	{
+		palloc_free_page(kpage);
+		return false;
+	}
+	return true;
+#endif
+}
+
+/* Unmaps and frees the stack page at UPAGE in LEADER's process.
+ * LEADER's `proc_lock' must be held. */
+static void
+user_stack_free(struct thread *leader, void *upage)
+{
+#ifdef VM
+	struct page *page = spt_find_page(&leader->spt, upage);
+
+	if (page != NULL)
+		spt_remove_page(&leader->spt, page);
+#else
+	void *kpage = pml4_get_page(leader->pml4, upage);
+
+	if (kpage != NULL)
+	{
+		pml4_clear_page(leader->pml4, upage);
+		palloc_free_page(kpage);
+	}
+#endif
+}
@@ -15,15 +15,12 @@
 #include "filesys/filesys.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "userprog/futex.h"
 #include "userprog/process.h"
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 
-/** #Project 2: System Call  **/
-// 멀티스레드 환경에서 파일 시스템의 동시 접근을 제어 하는 lock
-struct lock filesys_lock;
-
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -49,9 +46,7 @@ void syscall_init(void)
 	write_msr(MSR_SYSCALL_MASK,
 			  FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
-	/** #Project 2: System Call  **/
-	// filesys_lock 초기화
-	lock_init(&filesys_lock);
+	futex_init();
 }
 
 /** #Project 2: System Call **/
@@ -106,9 +101,27 @@ void syscall_handler(struct intr_frame *f UNUSED)
 	case SYS_CLOSE:
 		close(f->R.rdi);
 		break;
+	case SYS_SCHED_STATS:
+		f->R.rax = sched_stats(f->R.rdi, (struct sched_stats *)f->R.rsi);
+		break;
+	case SYS_FUTEX:
+		f->R.rax = futex((int *)f->R.rdi, f->R.rsi, f->R.rdx, (int *)f->R.r10, f->R.r8);
+		break;
+	case SYS_THREAD_CREATE:
+		f->R.rax = process_thread_create((void *)f->R.rdi, (void *)f->R.rsi, (void *)f->R.rdx);
+		break;
+	case SYS_THREAD_EXIT:
+		process_thread_exit();
+		break;
+	case SYS_THREAD_JOIN:
+		f->R.rax = process_thread_join(f->R.rdi);
+		break;
 	default:
 		exit(-1);
 	}
+
+	// 다른 스레드가 프로세스를 종료시켰으면 user 모드로 돌아가지 않고 종료
+	process_check_exit();
 }
 
 /** #Project 2: System Call - check_address **/
@@ -131,10 +144,11 @@ void halt(void)
 void exit(int status)
 {
 	struct thread *curr = thread_current();
-	curr->exit_status = status;
 
 	/** #Project 2: Process Termination Messages */
-	printf("%s: exit(%d)\n", curr->name, curr->exit_status);
+	// 어느 스레드가 호출하든 프로세스 전체가 종료되며, 종료 상태는 처음 호출한 것을 따름
+	if (process_mark_exiting(status))
+		printf("%s: exit(%d)\n", curr->leader->name, status);
 
 	thread_exit();
 }
@@ -223,11 +237,14 @@ int open(const char *file)
 int filesize(int fd)
 {
 	struct file *file = process_get_file(fd);
+	int length;
 
 	if (file == NULL)
 		return -1;
 
-	return file_length(file);
+	length = file_length(file);
+	file_close(file);
+	return length;
 }
 
 /** #Project 2: System Call - read **/
@@ -265,12 +282,9 @@ int read(int fd, void *buffer, unsigned length)
 	if (file == NULL)
 		return -1;
 
-	// 동시 접근을 제한하기 위해 Lock 설정
-	lock_acquire(&filesys_lock);
-	// 파일 내용 읽기
+	// 파일 내용 읽기 (동시 접근은 inode별 lock이 제어)
 	bytes = file_read(file, buffer, length);
-	// 읽기가 완료되면 Lock 해제
-	lock_release(&filesys_lock);
+	file_close(file);
 
 	return bytes;
 }
@@ -300,12 +314,9 @@ int write(int fd, const void *buffer, unsigned length)
 	if (file == NULL)
 		return -1;
 
-	// 동시 접근을 제한하기 위해 Lock 설정
-	lock_acquire(&filesys_lock);
-	// 파일에 내용 작성
+	// 파일에 내용 작성 (동시 접근은 inode별 lock이 제어)
 	bytes = file_write(file, buffer, length);
-	// 쓰기가 완료되면 Lock 해제
-	lock_release(&filesys_lock);
+	file_close(file);
 
 	return bytes;
 }
@@ -316,10 +327,11 @@ void seek(int fd, unsigned position)
 {
 	struct file *file = process_get_file(fd);
 
-	if (fd < 3 || file == NULL)
+	if (file == NULL)
 		return;
 
 	file_seek(file, position);
+	file_close(file);
 }
 
 /** #Project 2: System Call - tell **/
@@ -327,23 +339,58 @@ void seek(int fd, unsigned position)
 int tell(int fd)
 {
 	struct file *file = process_get_file(fd);
+	int pos;
 
-	if (fd < 3 || file == NULL)
+	if (file == NULL)
 		return -1;
 
-	return file_tell(file);
+	pos = file_tell(file);
+	file_close(file);
+	return pos;
 }
 
 /** #Project 2: System Call - close **/
 // 파일 디스크립터 fd를 닫는 함수
+// (fd 테이블에서 실제로 떼어낸 파일만 닫음 - 다른 스레드가 쓰는 중이면 참조만 놓음)
 void close(int fd)
 {
-	struct file *file = process_get_file(fd);
+	file_close(process_close_file(fd));
+}
 
-	if (fd < 3 || file == NULL)
-		return;
+/** sched_stats **/
+// pid로 지정된 스레드(0이면 호출한 프로세스)의 스케줄러 통계를 stats에 복사하는 시스템콜
+bool sched_stats(pid_t pid, struct sched_stats *stats)
+{
+	struct sched_stats kstats;
 
-	process_close_file(fd);
+	check_address(stats);
+	check_address((char *)stats + sizeof *stats - 1);
 
-	file_close(file);
-}
\ No newline at end of file
+	if (!thread_get_sched_stats(pid, &kstats))
+		return false;
+
+	memcpy(stats, &kstats, sizeof kstats);
+	return true;
+}
+
+/** futex **/
+// uaddr의 int 값을 기준으로 대기하거나 대기 중인 스레드를 깨우는 시스템콜
+int futex(int *uaddr, int op, int val, int *uaddr2, int val2)
+{
+	uint64_t *pml4 = thread_current()->pml4;
+
+	check_address(uaddr);
+
+	switch (op)
+	{
+	case FUTEX_WAIT:
+		return futex_wait(pml4, uaddr, val);
+	case FUTEX_WAKE:
+		return futex_wake(pml4, uaddr, val);
+	case FUTEX_REQUEUE:
+		check_address(uaddr2);
+		return futex_requeue(pml4, uaddr, val, uaddr2, val2);
+	default:
+		return -1;
+	}
+}